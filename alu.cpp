@@ -0,0 +1,71 @@
+/*
+* ALU flag tables, worked out bit by bit the way the hardware does it
+*/
+
+#include "alu.h"
+
+static const uint8_t Z = 0b10000000;
+static const uint8_t N = 0b01000000;
+static const uint8_t H = 0b00100000;
+static const uint8_t C = 0b00010000;
+
+static aluTables build_alu_tables() {
+    aluTables t;
+
+    for (unsigned carry = 0; carry < 2; carry++) {
+        for (unsigned a = 0; a < 0x100; a++) {
+            for (unsigned b = 0; b < 0x100; b++) {
+                unsigned sum = a + b + carry;
+                int diff = (int)a - (int)b - (int)carry;
+
+                t.add[carry][a][b] = ((sum & 0xFF) == 0x0 ? Z : 0x0) |
+                                     ((a & 0xF) + (b & 0xF) + carry > 0xF ? H : 0x0) |
+                                     (sum > 0xFF ? C : 0x0);
+                t.sub[carry][a][b] = ((diff & 0xFF) == 0x0 ? Z : 0x0) |
+                                     N |
+                                     ((int)(a & 0xF) - (int)(b & 0xF) - (int)carry < 0 ? H : 0x0) |
+                                     (diff < 0 ? C : 0x0);
+            }
+        }
+    }
+
+    for (unsigned res = 0; res < 0x100; res++) {
+        t.inc[res] = (res == 0x0 ? Z : 0x0) | ((res & 0xF) == 0x0 ? H : 0x0);
+        t.dec[res] = (res == 0x0 ? Z : 0x0) | N | ((res & 0xF) == 0xF ? H : 0x0);
+    }
+
+    // DAA: adjust A back to BCD after an add (N clear) or subtract (N set)
+    for (unsigned nhc = 0; nhc < 0x8; nhc++) {
+        bool n = nhc & 0x4;
+        bool h = nhc & 0x2;
+        bool c = nhc & 0x1;
+
+        for (unsigned a = 0; a < 0x100; a++) {
+            uint8_t adjust = 0x0;
+            uint8_t res;
+            bool carry = c;
+
+            if (!n) {
+                if (c || a > 0x99) {
+                    adjust |= 0x60;
+                    carry = true;
+                }
+                if (h || (a & 0xF) > 0x9)
+                    adjust |= 0x06;
+                res = (uint8_t)(a + adjust);
+            }
+            else {
+                if (c)
+                    adjust |= 0x60;
+                if (h)
+                    adjust |= 0x06;
+                res = (uint8_t)(a - adjust);
+            }
+
+            t.daa[nhc][a] = res << 8 | (res == 0x0 ? Z : 0x0) | (n ? N : 0x0) | (carry ? C : 0x0);
+        }
+    }
+    return t;
+}
+
+const aluTables alu_tables = build_alu_tables();
\ No newline at end of file
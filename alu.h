@@ -0,0 +1,23 @@
+#ifndef ALU_H
+#define ALU_H
+
+// C++ libraries
+#include <cstdint>
+
+// F after every 8-bit ALU operation, for every operand and carry in.
+// F is Z N H C 0000, as in CPU::registers. ADD/SUB/INC/DEC results are
+// just the byte the sum wraps to, so only their flags are kept; DAA's
+// result depends on the flags too and is kept with them.
+struct aluTables {
+    uint8_t add[2][0x100][0x100]; // [carry in][a][b]: ADD/ADC a, b
+    uint8_t sub[2][0x100][0x100]; // [carry in][a][b]: SUB/SBC/CP a, b
+    uint8_t inc[0x100];           // [result]: INC, without C (kept from before)
+    uint8_t dec[0x100];           // [result]: DEC, without C (kept from before)
+    uint16_t daa[0x8][0x100];     // [N H C][a]: A << 8 | F
+};
+
+// Built once at start-up: constant evaluation of 256 KiB is more than
+// some compilers allow
+extern const aluTables alu_tables;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+/*
+* alucheck - check every entry of alu_tables against arithmetic done
+* another way
+*
+* Usage: alucheck
+*
+* ADD/ADC and SUB/SBC/CP flags are checked for every operand pair and
+* carry in against a bit-at-a-time ripple-carry adder, INC and DEC
+* against the same adder adding or taking 1. DAA is checked after the
+* ADD/ADC and SUB/SBC of every pair of BCD bytes against decimal sums
+* and differences. The exit status is 1 if any entry is wrong.
+*/
+
+#include <cstdio>
+
+#include "alu.h"
+
+// F for a + b + carry in, or a - b - carry in, worked out a bit at a
+// time the way a ripple-carry adder does: subtracting adds ~b with the
+// carry in inverted, and borrows are the carries inverted
+static uint8_t ripple_flags(unsigned a, unsigned b, unsigned carry, bool subtract) {
+    unsigned c = subtract ? !carry : carry;
+    unsigned res = 0;
+    unsigned half = 0;
+
+    for (unsigned bit = 0; bit < 8; bit++) {
+        unsigned x = (a >> bit) & 1;
+        unsigned y = ((subtract ? ~b : b) >> bit) & 1;
+
+        res |= (x ^ y ^ c) << bit;
+        c = (x & y) | (c & (x ^ y));
+        if (bit == 3)
+            half = c;
+    }
+    if (subtract) {
+        half = !half;
+        c = !c;
+    }
+    return (res == 0 ? 0x80 : 0x00) | (subtract ? 0x40 : 0x00) | (half ? 0x20 : 0x00) | (c ? 0x10 : 0x00);
+}
+
+static uint8_t bcd(unsigned n) {
+    return (uint8_t)((n / 10) << 4 | n % 10);
+}
+
+// Mismatches between alu_tables and ripple_flags()/decimal arithmetic
+static unsigned check_alu() {
+    unsigned bad = 0;
+
+    for (unsigned carry = 0; carry < 2; carry++) {
+        for (unsigned a = 0; a < 0x100; a++) {
+            for (unsigned b = 0; b < 0x100; b++) {
+                bad += alu_tables.add[carry][a][b] != ripple_flags(a, b, carry, false);
+                bad += alu_tables.sub[carry][a][b] != ripple_flags(a, b, carry, true);
+            }
+        }
+    }
+    for (unsigned a = 0; a < 0x100; a++) {
+        bad += alu_tables.inc[(a + 1) & 0xFF] != (ripple_flags(a, 1, 0, false) & 0xE0);
+        bad += alu_tables.dec[(a - 1) & 0xFF] != (ripple_flags(a, 1, 0, true) & 0xE0);
+    }
+
+    // DAA after ADD/ADC and SUB/SBC of every pair of BCD bytes
+    for (unsigned carry = 0; carry < 2; carry++) {
+        for (unsigned x = 0; x < 100; x++) {
+            for (unsigned y = 0; y < 100; y++) {
+                uint8_t a = bcd(x);
+                uint8_t b = bcd(y);
+                uint8_t f = alu_tables.add[carry][a][b];
+                uint16_t daa = alu_tables.daa[(f >> 4) & 0x7][(a + b + carry) & 0xFF];
+                unsigned sum = x + y + carry;
+
+                bad += (daa >> 8) != bcd(sum % 100) || ((daa & 0x10) != 0) != (sum > 99);
+
+                int diff = (int)x - (int)y - (int)carry;
+
+                f = alu_tables.sub[carry][a][b];
+                daa = alu_tables.daa[(f >> 4) & 0x7][(a - b - carry) & 0xFF];
+                bad += (daa >> 8) != bcd((unsigned)(diff + 100) % 100) || ((daa & 0x10) != 0) != (diff < 0);
+            }
+        }
+    }
+    return bad;
+}
+
+int main() {
+    unsigned bad = check_alu();
+
+    if (bad != 0) {
+        std::printf("alu_tables: %u entries wrong\n", bad);
+        return 1;
+    }
+    std::printf("alu_tables: all entries match\n");
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+/*
+* bench - micro-benchmarks for OP code classes on each core and for
+* Memory::get_memory/set_memory on each region of the memory map
+*
+* Usage: bench [name filter]
+*
+* OP code classes run a straight line of 64 of their instructions,
+* then INC BC and JP back to the start (counted as instructions too),
+* from a fixed ROM image on a fresh CPU. INC BC keeps every pass
+* different so none of them is skipped as an idle loop. Memory
+* benchmarks walk each region a byte at a time. Every benchmark is
+* run once to warm up, then RUNS times, keeping the fastest.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "opinfo.h"
+
+static const int RUNS = 5;
+static const uint64_t CPU_CYCLES = 50000000;      // T-cycles per OP code run
+static const uint64_t MEMORY_ACCESSES = 20000000; // Per memory run
+static const uint16_t CODE = 0x0150;              // Where the instructions go
+static const uint16_t SUBROUTINE = 0x3000;        // RET, for CALL
+static const std::size_t REPEAT = 64;             // Instructions a pass, before INC BC/JP
+
+struct opBench {
+    const char* name;
+    std::vector<uint8_t> sequence; // Repeated to REPEAT instructions or more
+};
+
+// clang-format off
+static const opBench op_benches[] = {
+    {"alu8",     {0x80, 0x89, 0x92, 0xA3, 0xAC, 0xB5, 0xB8, 0x3C, 0x0D, 0xC6, 0x11}}, // ADD A,B ADC A,C SUB D AND E XOR H OR L CP B INC A DEC C ADD A,$11
+    {"ld16",     {0x21, 0x00, 0xC0, 0x11, 0x00, 0xC1, 0x7E, 0x77, 0x12, 0x1A, 0xFA, 0x00, 0xD0, 0xEA, 0x01, 0xD0, 0x08, 0x02, 0xD0}}, // LD HL/DE,d16 LD A,(HL) LD (HL),A LD (DE),A LD A,(DE) LD A,(a16) LD (a16),A LD (a16),SP
+    {"push_pop", {0xC5, 0xD1, 0xD5, 0xE1, 0xE5, 0xF1, 0xF5, 0xC1}},                   // PUSH BC POP DE PUSH DE POP HL PUSH HL POP AF PUSH AF POP BC
+    {"call_ret", {0xCD, SUBROUTINE & 0xFF, SUBROUTINE >> 8}},                          // CALL SUBROUTINE, which is a RET
+    {"cb",       {0xCB, 0x00, 0xCB, 0x37, 0xCB, 0x59, 0xCB, 0xEA, 0xCB, 0x8B, 0xCB, 0x3C, 0xCB, 0x1D}}, // RLC B SWAP A BIT 3,C SET 5,D RES 1,E SRL H RR L
+};
+// clang-format on
+
+struct memoryBench {
+    const char* name;
+    uint16_t start;
+    uint16_t size;
+};
+
+// clang-format off
+static const memoryBench memory_benches[] = {
+    {"rom0",  0x0000, 0x4000},
+    {"romx",  0x4000, 0x4000},
+    {"vram",  0x8000, 0x2000},
+    {"sram",  0xA000, 0x2000},
+    {"wram",  0xC000, 0x2000},
+    {"echo",  0xE000, 0x1E00},
+    {"oam",   0xFE00, 0x00A0},
+    {"io",    0xFF47, 0x0005}, // Palettes and window: plain registers
+    {"timed", 0xFF04, 0x0004}, // DIV, TIMA, TMA, TAC: go through Scheduler
+    {"hram",  0xFF80, 0x007F},
+};
+// clang-format on
+
+static volatile uint32_t sink; // Keeps memory reads from being optimized out
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A pass of `b`'s code: the sequence repeated, INC BC, JP back
+static std::unique_ptr<CPU> op_cpu(const opBench& b, uint8_t core, uint32_t& pass_ops, uint32_t& pass_cycles) {
+    std::unique_ptr<CPU> cpu(new CPU());
+    uint16_t addr = CODE;
+
+    pass_ops = 0;
+    pass_cycles = 0;
+    cpu->core = core;
+    cpu->gbmemory.set_memory(0x0100, 0xC3); // JP CODE
+    cpu->gbmemory.set_memory(0x0101, CODE & 0xFF);
+    cpu->gbmemory.set_memory(0x0102, CODE >> 8);
+    cpu->gbmemory.set_memory(SUBROUTINE, 0xC9);
+
+    while (pass_ops < REPEAT) {
+        for (std::size_t i = 0; i < b.sequence.size();) {
+            uint8_t opcode = b.sequence[i];
+            const opInfo& info = op_info[opcode];
+
+            pass_ops++;
+            pass_cycles += opcode == 0xCB ? op_info[0x100 | b.sequence[i + 1]].cycles : info.cycles;
+            if (opcode == 0xCD) {
+                pass_ops++; // and the RET
+                pass_cycles += op_info[0xC9].cycles;
+            }
+            for (std::size_t n = 0; n < info.length; n++) {
+                cpu->gbmemory.set_memory(addr++, b.sequence[i++]);
+            }
+        }
+    }
+
+    const uint8_t trailer[] = {0x03, 0xC3, CODE & 0xFF, CODE >> 8}; // INC BC, JP CODE
+
+    for (uint8_t byte : trailer) {
+        cpu->gbmemory.set_memory(addr++, byte);
+    }
+    pass_ops += 2;
+    pass_cycles += op_info[0x03].cycles + op_info[0xC3].cycles;
+    return cpu;
+}
+
+static void run_op_bench(const opBench& b, uint8_t core) {
+    double best = 0.0;
+    uint64_t ops = 0;
+
+    for (int run = 0; run <= RUNS; run++) {
+        uint32_t pass_ops, pass_cycles;
+        std::unique_ptr<CPU> cpu = op_cpu(b, core, pass_ops, pass_cycles);
+        auto start = std::chrono::steady_clock::now();
+
+        cpu->run_for(CPU_CYCLES);
+
+        double took = seconds_since(start);
+
+        // Run 0 warms up
+        if (run == 1 || (run > 1 && took < best))
+            best = took;
+        ops = cpu->cycles / pass_cycles * pass_ops;
+    }
+
+    std::printf("%-10s %-12s %9.2f ns/op %9.1f Minstr/s\n", b.name, CPU::core_names[core], best * 1e9 / ops, ops / best / 1e6);
+}
+
+static void run_memory_bench(const memoryBench& b, bool write) {
+    double best = 0.0;
+
+    for (int run = 0; run <= RUNS; run++) {
+        std::unique_ptr<CPU> cpu(new CPU());
+        Memory& mem = cpu->gbmemory;
+        uint32_t sum = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint64_t i = 0; i < MEMORY_ACCESSES;) {
+            for (uint16_t off = 0; off < b.size && i < MEMORY_ACCESSES; off++, i++) {
+                if (write)
+                    mem.set_memory(b.start + off, (uint8_t)i);
+                else
+                    sum += mem.get_memory(b.start + off);
+            }
+        }
+
+        double took = seconds_since(start);
+
+        sink = sum;
+        if (run == 1 || (run > 1 && took < best))
+            best = took;
+    }
+
+    std::printf("%-10s %-12s %9.2f ns/op %9.1f Maccess/s\n", b.name, write ? "set_memory" : "get_memory", best * 1e9 / MEMORY_ACCESSES, MEMORY_ACCESSES / best / 1e6);
+}
+
+int main(int argc, char** argv) {
+    std::string filter = argc > 1 ? argv[1] : "";
+
+    for (const opBench& b : op_benches) {
+        if (std::string(b.name).find(filter) == std::string::npos)
+            continue;
+        for (uint8_t core = CPU::CORE_INTERPRETER; core < CPU::CORE_COUNT; core++) {
+            run_op_bench(b, core);
+        }
+    }
+    for (const memoryBench& b : memory_benches) {
+        if (std::string(b.name).find(filter) == std::string::npos)
+            continue;
+        run_memory_bench(b, false);
+        run_memory_bench(b, true);
+    }
+    return 0;
+}
\ No newline at end of file
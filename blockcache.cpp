@@ -0,0 +1,328 @@
+/*
+* Pre-decoded basic blocks for CPU::run_blocks()
+*/
+
+#include "blockcache.h"
+
+#include <algorithm>
+
+#include "cpu.h"
+
+// Jumps, calls, returns, restarts, HALT/STOP, DI/EI and unused OP codes
+// end a block: whatever follows them is not known to run next
+static bool ends_block(uint8_t opcode) {
+    uint8_t x = opcode >> 6;
+    uint8_t y = (opcode >> 3) & 0x7;
+    uint8_t z = opcode & 0x7;
+
+    if (x == 0)
+        return z == 0 && y >= 2;
+    if (x == 1)
+        return opcode == 0x76;
+    if (x == 2)
+        return false;
+
+    switch (z) {
+    case (0):
+        return y < 4;
+    case (1):
+        return y == 1 || y == 3 || y == 5;
+    case (2):
+        return y < 4;
+    case (3):
+        return y != 1;
+    case (4):
+        return true;
+    case (5):
+        return y != 0 && y != 2 && y != 4 && y != 6;
+    case (6):
+        return false;
+    default:
+        return true;
+    }
+}
+
+// Stores, pushes, and read-modify-writes of (HL)
+static bool writes_memory(uint8_t opcode, uint8_t cbop) {
+    switch (opcode) {
+    case (0x02):
+    case (0x12):
+    case (0x22):
+    case (0x32):
+    case (0x08):
+    case (0x34):
+    case (0x35):
+    case (0x36):
+    case (0xE0):
+    case (0xE2):
+    case (0xEA):
+    case (0xC5):
+    case (0xD5):
+    case (0xE5):
+    case (0xF5):
+        return true;
+    case (0xCB):
+        return (cbop & 0x7) == 0x6 && (cbop & 0xC0) != 0x40;
+    default:
+        return opcode >= 0x70 && opcode <= 0x77 && opcode != 0x76;
+    }
+}
+
+// 0: ROM bank 0, 1: switchable ROM bank, 2: RAM, 3: I/O registers
+static uint8_t region(uint16_t addr) {
+    if (addr < 0x8000)
+        return addr >> 14;
+    return addr >= 0xFF00 && addr < 0xFF80 ? 3 : 2;
+}
+
+// Bytes covered and T-cycles of one pass, by CPU::fusedOp
+static const uint8_t fused_length[CPU::FUSED_COUNT] = {3, 4, 6, 3};
+static const uint8_t fused_cycles[CPU::FUSED_COUNT] = {24, 32, 32, 16};
+
+// Match an idiom to fuse at addr, see CPU::fusedOp.
+// Returns the CPU::fusedOp and its operand, or NOT_FUSED.
+static uint8_t match_fused(Memory& mem, uint16_t addr, uint16_t& arg) {
+    uint8_t b[6];
+
+    if (addr >= 0xFF00 - sizeof(b))
+        return BlockCache::NOT_FUSED;
+
+    for (std::size_t i = 0; i < sizeof(b); i++) {
+        b[i] = mem.get_memory(addr + i);
+    }
+
+    if (b[0] == 0x2A && b[1] == 0x12 && b[2] == 0x13)
+        return b[3] == 0x0B ? CPU::FUSED_COPY_BC : CPU::FUSED_COPY;
+
+    if (b[0] == 0xF0 && b[2] == 0xFE && b[4] == 0x20 && b[5] == 0xFA) {
+        arg = b[1] | (b[3] << 8);
+        return CPU::FUSED_POLL;
+    }
+
+    // DEC r, not DEC (HL)
+    if ((b[0] & 0xC7) == 0x05 && b[0] != 0x35 && b[1] == 0x20 && b[2] == 0xFD) {
+        arg = (b[0] >> 3) & 0x7;
+        return CPU::FUSED_DELAY;
+    }
+    return BlockCache::NOT_FUSED;
+}
+
+// Page Memory marks as dirty when addr is written, with echo RAM
+// folded onto the RAM it mirrors
+static uint8_t code_page(uint16_t addr) {
+    return (addr >= 0xE000 && addr < 0xFE00 ? addr - 0x2000 : addr) >> 8;
+}
+
+// Last address of the bytes from `start` up to `end`. An OP code at
+// 0xFFFF has its operands wrap round to 0x0000, past which the page
+// loops can't count, so those stop at 0xFFFF.
+static uint16_t last_byte(uint16_t start, uint16_t end) {
+    return end != 0 && end <= start ? 0xFFFF : (uint16_t)(end - 1);
+}
+
+BlockCache::BlockCache() {
+#ifdef GBEMU_EVERY_OP
+    // Profiles and traces want the instructions fused handlers stand in for
+    fuse = false;
+#else
+    fuse = true;
+#endif
+    for (std::size_t i = 0; i < 0x400; i++) {
+        recent[i] = nullptr;
+    }
+}
+
+// Blocks point back into their own cache, so a copy starts out empty
+// and decodes again
+BlockCache::BlockCache(const BlockCache& cache) : BlockCache() {
+}
+
+BlockCache& BlockCache::operator=(const BlockCache& cache) {
+    clear();
+    return *this;
+}
+
+// Block starting at pc in whatever bank is mapped there now,
+// decoding it first if it isn't cached
+BlockCache::block& BlockCache::lookup(Memory& mem, uint16_t pc) {
+    uint16_t bank = bank_of(mem, pc);
+    block* b = recent[pc & 0x3FF];
+
+    if (b != nullptr && b->start == pc && b->bank == bank)
+        return *b;
+
+    auto found = blocks.find((uint32_t)bank << 16 | pc);
+    b = found != blocks.end() ? &found->second : &decode(mem, pc, bank);
+    recent[pc & 0x3FF] = b;
+    return *b;
+}
+
+// Drop every block decoded from a RAM page written since it was decoded,
+// or a ROM page when there's no cartridge and ROM is plain memory
+void BlockCache::flush_dirty(Memory& mem) {
+    bool any = false;
+
+    for (std::size_t i = 0; i < 0x100; i++) {
+        any |= mem.dirty_pages[i];
+    }
+
+    // Only left to look at interrupts
+    if (!any) {
+        mem.exit_blocks = false;
+        return;
+    }
+
+    for (auto it = blocks.begin(); it != blocks.end();) {
+        const block& b = it->second;
+        bool dirty = false;
+
+        if (b.start >= 0x8000 || mem.cart.rom == nullptr) {
+            for (unsigned at = b.start & 0xFF00; at <= last_byte(b.start, b.end); at += 0x100) {
+                dirty |= mem.dirty_pages[code_page(at)];
+            }
+        }
+
+        if (dirty)
+            it = blocks.erase(it);
+        else
+            ++it;
+    }
+
+    for (std::size_t i = 0; i < 0x100; i++) {
+        mem.dirty_pages[i] = false;
+    }
+    for (std::size_t i = 0; i < 0x400; i++) {
+        recent[i] = nullptr;
+    }
+    mem.exit_blocks = false;
+}
+
+bool BlockCache::cacheable(uint16_t pc) {
+    return region(pc) != 3;
+}
+
+void BlockCache::clear() {
+    blocks.clear();
+
+    for (std::size_t i = 0; i < 0x400; i++) {
+        recent[i] = nullptr;
+    }
+}
+
+// Private ////////////////////
+
+// RAM blocks are invalidated on write instead, so they all share bank 0
+uint16_t BlockCache::bank_of(Memory& mem, uint16_t addr) {
+    switch (region(addr)) {
+    case (0):
+        return mem.rom_bank0;
+    case (1):
+        return mem.rom_bank;
+    default:
+        return 0;
+    }
+}
+
+BlockCache::block& BlockCache::decode(Memory& mem, uint16_t pc, uint16_t bank) {
+    block& b = blocks[(uint32_t)bank << 16 | pc];
+    uint16_t addr = pc;
+    uint16_t next;
+
+    b.start = pc;
+    b.bank = bank;
+    b.max_cycles = 0;
+    b.hits = 0;
+    b.code = nullptr;
+    b.ops.clear();
+
+    for (;;) {
+        uint8_t opcode = mem.get_memory(addr);
+        uint8_t len = op_info[opcode].length;
+        uint16_t arg = 0;
+        uint8_t fused = fuse ? match_fused(mem, addr, arg) : NOT_FUSED;
+
+        if (fused != NOT_FUSED && region(addr + fused_length[fused] - 1) == region(pc)) {
+            // Fused handlers add their own cycles and stop at the deadline
+            // themselves, so max_cycles only needs one pass of them
+            len = fused_length[fused];
+            b.ops.push_back({CPU::fused_handlers[fused], arg, opcode, fused, len, 0, 0});
+            b.max_cycles += fused_cycles[fused];
+        }
+        else {
+            if (len == 2)
+                arg = mem.get_memory(addr + 1);
+            else if (len == 3)
+                arg = mem.get_memory(addr + 1) | (mem.get_memory(addr + 2) << 8);
+
+            const opInfo& info = op_info[opcode];
+
+            fused = NOT_FUSED;
+            b.ops.push_back({CPU::opcodes[opcode], arg, opcode, NOT_FUSED, len, info.cycles, info.cycles_branch});
+            // CB OP codes add their own T-cycles
+            b.max_cycles += opcode == 0xCB ? op_info[0x100 | arg].cycles : std::max(info.cycles, info.cycles_branch);
+        }
+        next = addr + len;
+
+        // Writes to these pages have to throw the block away. Without a
+        // cartridge that goes for ROM too: writes land in memory_map.
+        if (region(addr) == 2 || mem.cart.rom == nullptr) {
+            for (unsigned at = addr & 0xFF00; at <= last_byte(addr, next); at += 0x100) {
+                mem.watch_code(code_page(at));
+            }
+        }
+
+        // Fused sequences ending in JR end the block like the JR would
+        if ((fused == NOT_FUSED ? ends_block(opcode) : fused == CPU::FUSED_POLL || fused == CPU::FUSED_DELAY) || b.ops.size() == MAX_BLOCK_OPS || next < addr || region(next) != region(pc))
+            break;
+        addr = next;
+    }
+
+    b.end = next;
+    b.loop_cycles = idle_loop_cycles(b);
+    b.loop_misses = 0;
+    return b;
+}
+
+// A block that jumps straight back to its own start without writing
+// anything may be waiting on an I/O register: once a pass leaves every
+// register as it found them, the next passes will too until what it
+// reads changes. CPU::idle_loop() checks that at runtime; this only
+// rules out what can't be one. CB ops on (HL) are left out to keep
+// the pass length fixed.
+uint16_t BlockCache::idle_loop_cycles(const block& b) {
+    const microOp& last = b.ops.back();
+    uint16_t target;
+    uint16_t cycles = 0;
+
+    switch (last.opcode) {
+    case (0x18):
+    case (0x20):
+    case (0x28):
+    case (0x30):
+    case (0x38):
+        target = b.end + (int8_t)last.arg;
+        break;
+    case (0xC2):
+    case (0xC3):
+    case (0xCA):
+    case (0xD2):
+    case (0xDA):
+        target = last.arg;
+        break;
+    default:
+        return 0;
+    }
+    if (target != b.start || last.fused != NOT_FUSED)
+        return 0;
+
+    for (std::size_t i = 0; i + 1 < b.ops.size(); i++) {
+        const microOp& op = b.ops[i];
+
+        if (op.fused != NOT_FUSED || writes_memory(op.opcode, (uint8_t)op.arg))
+            return 0;
+        if (op.opcode == 0xCB && (op.arg & 0x7) == 0x6)
+            return 0;
+        cycles += op.opcode == 0xCB ? op_info[0x100 | op.arg].cycles : op.cycles;
+    }
+    return cycles + last.cycles_branch;
+}
\ No newline at end of file
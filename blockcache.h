@@ -0,0 +1,73 @@
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+// C++ libraries
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// GBemu sources
+#include "memory.h"
+
+class CPU;
+
+// Cache of pre-decoded basic blocks: straight runs of instructions
+// up to and including the first one that can change PC another way.
+// Each instruction is kept as its handler with the operand already
+// fetched, so running a block skips the fetch/decode work entirely.
+// Code in the I/O registers can change without being written to, so
+// it is never cached; blocks stop short of it.
+class BlockCache {
+    public:
+    using handler = void (CPU::*)(uint16_t);
+    using native = void (*)(CPU*, uint64_t); // CPU, cycle target
+
+    static const std::size_t MAX_BLOCK_OPS = 64;
+    static const uint8_t NOT_FUSED = 0xFF;
+    static const uint8_t MAX_LOOP_MISSES = 8; // Before a block stops being an idle loop candidate
+
+    struct microOp {
+        handler fn;            // Handler from CPU::opcodes
+        uint16_t arg;          // Immediate operand (if any)
+        uint8_t opcode;        // OP code the handler was picked for
+        uint8_t fused;         // CPU::fusedOp if fn is a fused handler
+        uint8_t len;           // Instruction length in bytes
+        uint8_t cycles;        // T-cycles, branch not taken
+        uint8_t cycles_branch; // T-cycles, branch taken
+    };
+
+    struct block {
+        uint16_t start;       // Address of the first instruction
+        uint16_t end;         // Address after the last instruction
+        uint16_t bank;        // ROM bank the block was decoded from
+        uint16_t max_cycles;  // T-cycles if every branch in it is taken
+        uint16_t loop_cycles; // T-cycles of a pass if it may be an idle loop, else 0
+        uint8_t loop_misses;  // Passes in a row CPU::idle_loop() found changing state
+        uint32_t hits;        // Times looked up, for the JIT
+        native code;          // JIT-compiled block, or nullptr
+        std::vector<microOp> ops;
+    };
+
+    bool fuse; // Decode common idioms as one fused handler
+
+    BlockCache();
+    BlockCache(const BlockCache& cache);
+    BlockCache& operator=(const BlockCache& cache);
+    block& lookup(Memory& mem, uint16_t pc);
+    void flush_dirty(Memory& mem);
+    void clear();
+    static bool cacheable(uint16_t pc);
+
+    private:
+    // Blocks keyed by bank << 16 | start
+    std::unordered_map<uint32_t, block> blocks;
+    // Direct-mapped on the low bits of PC, in front of `blocks`
+    block* recent[0x400];
+
+    static uint16_t bank_of(Memory& mem, uint16_t addr);
+    static uint16_t idle_loop_cycles(const block& b);
+    block& decode(Memory& mem, uint16_t pc, uint16_t bank);
+};
+
+#endif
\ No newline at end of file
@@ -5,4041 +5,1421 @@
 
 #include "cpu.h"
 
-// AF BC DE HL
-struct CPU::registerMap registers;
+#include <utility>
+
+// OP code bit fields: xx yyy zzz, yyy = ppq
+// Every base OP code's handler is picked from these at compile time,
+// so each table entry is a straight-line handler with its operands
+// already decoded.
+template<uint8_t Op, typename Timing = CPU::instructionTiming>
+constexpr CPU::handler decode_op() {
+    constexpr uint8_t x = Op >> 6;
+    constexpr uint8_t y = (Op >> 3) & 0x7;
+    constexpr uint8_t z = Op & 0x7;
+    constexpr uint8_t q = y & 0x1;
+
+    if constexpr (Op == 0x00)
+        return &CPU::op_Nop;
+    else if constexpr (Op == 0x08)
+        return &CPU::op_Load<Op, Timing>;
+    else if constexpr (Op == 0x10)
+        return &CPU::op_Stop;
+    else if constexpr (x == 0 && z == 0)
+        return &CPU::op_Jump<Op>;
+    else if constexpr (x == 0 && z == 1 && q == 0)
+        return &CPU::op_Load<Op, Timing>;
+    else if constexpr (x == 0 && z == 1)
+        return &CPU::op_Add<Op, Timing>;
+    else if constexpr (x == 0 && z == 2)
+        return &CPU::op_Load<Op, Timing>;
+    else if constexpr (x == 0 && z == 3 && q == 0)
+        return &CPU::op_Increment<Op, Timing>;
+    else if constexpr (x == 0 && z == 3)
+        return &CPU::op_Decrement<Op, Timing>;
+    else if constexpr (x == 0 && z == 4)
+        return &CPU::op_Increment<Op, Timing>;
+    else if constexpr (x == 0 && z == 5)
+        return &CPU::op_Decrement<Op, Timing>;
+    else if constexpr (x == 0 && z == 6)
+        return &CPU::op_Load<Op, Timing>;
+    else if constexpr (x == 0 && y < 4)
+        return &CPU::op_Rotate<Op>;
+    else if constexpr (Op == 0x27)
+        return &CPU::op_Decimal;
+    else if constexpr (Op == 0x2F)
+        return &CPU::op_Complement;
+    else if constexpr (Op == 0x37)
+        return &CPU::op_Carry;
+    else if constexpr (Op == 0x3F)
+        return &CPU::op_CompCarry;
+    else if constexpr (Op == 0x76)
+        return &CPU::op_Halt;
+    else if constexpr (x == 1)
+        return &CPU::op_Load<Op, Timing>;
+    else if constexpr ((x == 2 || (x == 3 && z == 6)) && y < 2)
+        return &CPU::op_Add<Op, Timing>;
+    else if constexpr ((x == 2 || (x == 3 && z == 6)) && y < 4)
+        return &CPU::op_Subtract<Op, Timing>;
+    else if constexpr ((x == 2 || (x == 3 && z == 6)) && y == 4)
+        return &CPU::op_And<Op, Timing>;
+    else if constexpr ((x == 2 || (x == 3 && z == 6)) && y == 5)
+        return &CPU::op_Xor<Op, Timing>;
+    else if constexpr ((x == 2 || (x == 3 && z == 6)) && y == 6)
+        return &CPU::op_Or<Op, Timing>;
+    else if constexpr (x == 2 || (x == 3 && z == 6))
+        return &CPU::op_Compare<Op, Timing>;
+    else if constexpr ((x == 3 && z == 0 && y < 4) || Op == 0xC9 || Op == 0xD9)
+        return &CPU::op_Return<Op, Timing>;
+    else if constexpr (Op == 0xE0 || Op == 0xF0 || Op == 0xE2 || Op == 0xF2 || Op == 0xEA || Op == 0xFA || Op == 0xF8 || Op == 0xF9)
+        return &CPU::op_Load<Op, Timing>;
+    else if constexpr (Op == 0xE8)
+        return &CPU::op_Add<Op, Timing>;
+    else if constexpr (x == 3 && z == 1 && q == 0)
+        return &CPU::op_Pop<Op, Timing>;
+    else if constexpr (x == 3 && z == 5 && q == 0)
+        return &CPU::op_Push<Op, Timing>;
+    else if constexpr ((x == 3 && z == 2 && y < 4) || Op == 0xC3 || Op == 0xE9)
+        return &CPU::op_Jump<Op>;
+    else if constexpr ((x == 3 && z == 4 && y < 4) || Op == 0xCD)
+        return &CPU::op_Call<Op, Timing>;
+    else if constexpr (x == 3 && z == 7)
+        return &CPU::op_Restart<Op, Timing>;
+    else if constexpr (Op == 0xCB)
+        return &CPU::op_CB<Timing>;
+    else if constexpr (Op == 0xF3)
+        return &CPU::op_DInterrupt;
+    else if constexpr (Op == 0xFB)
+        return &CPU::op_EInterrupt;
+    else
+        return &CPU::op_Unknown;
+}
+
+template<typename Timing, std::size_t... Op>
+constexpr std::array<CPU::handler, 0x100> build_opcodes(std::index_sequence<Op...>) {
+    return {{decode_op<Op, Timing>()...}};
+}
 
 // Array mapping OP code (as index) to function for handling the OP code
-void (CPU::*opcodes[0x100])(uint8_t, uint16_t) = {
-    // clang-format off
-//  x0                  x1                  x2                  x3                  x4                  x5                  x6                  x7                  x8                  x9                  xA                  xB                  xC                  xD                  xE                  xF
-    &CPU::op_Nop,       &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Increment, &CPU::op_Increment, &CPU::op_Decrement, &CPU::op_Load,      &CPU::op_Rotate,    &CPU::op_Load,      &CPU::op_Add,       &CPU::op_Load,      &CPU::op_Decrement, &CPU::op_Increment, &CPU::op_Decrement, &CPU::op_Load,      &CPU::op_Rotate,
-    &CPU::op_Stop,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Increment, &CPU::op_Increment, &CPU::op_Decrement, &CPU::op_Load,      &CPU::op_Rotate,    &CPU::op_Jump,      &CPU::op_Add,       &CPU::op_Load,      &CPU::op_Decrement, &CPU::op_Increment, &CPU::op_Decrement, &CPU::op_Load,      &CPU::op_Rotate,
-    &CPU::op_Jump,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Increment, &CPU::op_Increment, &CPU::op_Decrement, &CPU::op_Load,      &CPU::op_Decimal,   &CPU::op_Jump,      &CPU::op_Add,       &CPU::op_Load,      &CPU::op_Decrement, &CPU::op_Increment, &CPU::op_Decrement, &CPU::op_Load,      &CPU::op_Complement,
-    &CPU::op_Jump,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Increment, &CPU::op_Increment, &CPU::op_Decrement, &CPU::op_Load,      &CPU::op_Carry,     &CPU::op_Jump,      &CPU::op_Add,       &CPU::op_Load,      &CPU::op_Decrement, &CPU::op_Increment, &CPU::op_Decrement, &CPU::op_Load,      &CPU::op_Carry,
-    &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,
-    &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,
-    &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,
-    &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Halt,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,
-    &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,       &CPU::op_Add,
-    &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,  &CPU::op_Subtract,
-    &CPU::op_And,       &CPU::op_And,       &CPU::op_And,       &CPU::op_And,       &CPU::op_And,       &CPU::op_And,       &CPU::op_And,       &CPU::op_And,       &CPU::op_Xor,       &CPU::op_Xor,       &CPU::op_Xor,       &CPU::op_Xor,       &CPU::op_Xor,       &CPU::op_Xor,       &CPU::op_Xor,       &CPU::op_Xor,
-    &CPU::op_Or,        &CPU::op_Or,        &CPU::op_Or,        &CPU::op_Or,        &CPU::op_Or,        &CPU::op_Or,        &CPU::op_Or,        &CPU::op_Or,        &CPU::op_Compare,   &CPU::op_Compare,   &CPU::op_Compare,   &CPU::op_Compare,   &CPU::op_Compare,   &CPU::op_Compare,   &CPU::op_Compare,   &CPU::op_Compare,
-    &CPU::op_Return,    &CPU::op_Pop,       &CPU::op_Jump,      &CPU::op_Jump,      &CPU::op_Call,      &CPU::op_Push,      &CPU::op_Add,       &CPU::op_Restart,   &CPU::op_Return,    &CPU::op_Return,    &CPU::op_Jump,      &CPU::op_CB,        &CPU::op_Call,      &CPU::op_Call,      &CPU::op_Add,       &CPU::op_Restart,
-    &CPU::op_Return,    &CPU::op_Pop,       &CPU::op_Jump,      &CPU::op_Unknown,   &CPU::op_Call,      &CPU::op_Push,      &CPU::op_Subtract,  &CPU::op_Restart,   &CPU::op_Return,    &CPU::op_Return,    &CPU::op_Jump,      &CPU::op_Unknown,   &CPU::op_Call,      &CPU::op_Unknown,   &CPU::op_Subtract,  &CPU::op_Restart,
-    &CPU::op_Load,      &CPU::op_Pop,       &CPU::op_Load,      &CPU::op_Unknown,   &CPU::op_Unknown,   &CPU::op_Push,      &CPU::op_And,       &CPU::op_Restart,   &CPU::op_Add,       &CPU::op_Jump,      &CPU::op_Load,      &CPU::op_Unknown,   &CPU::op_Unknown,   &CPU::op_Unknown,   &CPU::op_Xor,       &CPU::op_Restart,
-    &CPU::op_Load,      &CPU::op_Pop,       &CPU::op_Load,      &CPU::op_DInterrupt,&CPU::op_Unknown,   &CPU::op_Push,      &CPU::op_Or,        &CPU::op_Restart,   &CPU::op_Load,      &CPU::op_Load,      &CPU::op_Load,      &CPU::op_EInterrupt,&CPU::op_Unknown,   &CPU::op_Unknown,   &CPU::op_Compare,   &CPU::op_Restart
-//  x0                  x1                  x2                  x3                  x4                  x5                  x6                  x7                  x8                  x9                  xA                  xB                  xC                  xD                  xE                  xF
-};
-
-// Maps Z80-added "CB" OP codes
-void (CPU::*CBops[0x100])(uint8_t, uint16_t) = {
-//  x0                  x1                  x2                  x3                  x4                  x5                  x6                  x7                  x8                  x9                  xA                  xB                  xC                  xD                  xE                  xF
-    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,
-    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,    &CPU::op_Rotate,
-    &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,
-    &CPU::op_Swap,      &CPU::op_Swap,      &CPU::op_Swap,      &CPU::op_Swap,      &CPU::op_Swap,      &CPU::op_Swap,      &CPU::op_Swap,      &CPU::op_Swap,      &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,     &CPU::op_Shift,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,
-    &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit,       &CPU::op_Bit
-//  x0                  x1                  x2                  x3                  x4                  x5                  x6                  x7                  x8                  x9                  xA                  xB                  xC                  xD                  xE                  xF
-    // clang-format on
-};
+const std::array<CPU::handler, 0x100> CPU::opcodes = build_opcodes<CPU::instructionTiming>(std::make_index_sequence<0x100>{});
+
+// The same handlers built for CORE_MCYCLE
+const std::array<CPU::handler, 0x100> CPU::mcycle_opcodes = build_opcodes<CPU::mcycleTiming>(std::make_index_sequence<0x100>{});
+
+template<uint8_t Op>
+static void call_op(CPU& cpu, uint16_t arg) {
+    (cpu.*decode_op<Op>())(arg);
+}
+
+template<std::size_t... Op>
+constexpr std::array<CPU::thunk, 0x100> build_thunks(std::index_sequence<Op...>) {
+    return {{&call_op<Op>...}};
+}
+
+// CPU::opcodes as plain functions
+const std::array<CPU::thunk, 0x100> CPU::thunks = build_thunks(std::make_index_sequence<0x100>{});
+
+// Fused OP code handlers, indexed by CPU::fusedOp
+const std::array<CPU::handler, CPU::FUSED_COUNT> CPU::fused_handlers = {
+    &CPU::fused_Copy<false>,
+    &CPU::fused_Copy<true>,
+    &CPU::fused_Poll,
+    &CPU::fused_Delay};
+
+template<uint8_t Kind>
+static void call_fused(CPU& cpu, uint16_t arg) {
+    (cpu.*CPU::fused_handlers[Kind])(arg);
+}
+
+const std::array<CPU::thunk, CPU::FUSED_COUNT> CPU::fused_thunks = {
+    &call_fused<CPU::FUSED_COPY>,
+    &call_fused<CPU::FUSED_COPY_BC>,
+    &call_fused<CPU::FUSED_POLL>,
+    &call_fused<CPU::FUSED_DELAY>};
+
+const char* const CPU::fused_names[CPU::FUSED_COUNT] = {"copy", "copy_bc", "poll", "delay"};
+
+// CB OP codes: xx yyy zzz again. x = 0 is a rotate/shift picked by y,
+// otherwise BIT/RES/SET of bit y; z is the register as in read_r8()
+template<uint8_t Op, typename Timing>
+constexpr CPU::cb_handler decode_cb() {
+    constexpr uint8_t x = Op >> 6;
+
+    if constexpr (x == 0)
+        return &CPU::cb_Shift<Op, Timing>;
+    else if constexpr (x == 1)
+        return &CPU::cb_Bit<Op, Timing>;
+    else if constexpr (x == 2)
+        return &CPU::cb_Res<Op, Timing>;
+    else
+        return &CPU::cb_Set<Op, Timing>;
+}
+
+template<typename Timing, std::size_t... Op>
+constexpr std::array<CPU::cb_handler, 0x100> build_cb_opcodes(std::index_sequence<Op...>) {
+    return {{decode_cb<Op, Timing>()...}};
+}
+
+// Array mapping CB-prefixed OP code (as index) to its handler
+const std::array<CPU::cb_handler, 0x100> CPU::cb_opcodes = build_cb_opcodes<CPU::instructionTiming>(std::make_index_sequence<0x100>{});
+const std::array<CPU::cb_handler, 0x100> CPU::mcycle_cb_opcodes = build_cb_opcodes<CPU::mcycleTiming>(std::make_index_sequence<0x100>{});
+
+const char* const CPU::core_names[CPU::CORE_COUNT] = {"interpreter", "blocks", "jit", "mcycle"};
 
 CPU::CPU() {
+    core = CORE_JIT;
+    power_on();
 }
 
-// Initialize registers to boot-up state
 CPU::CPU(Memory& mem) {
     gbmemory = mem;
+    core = CORE_JIT;
+    power_on();
+}
+
+// Initialize registers to boot-up state
+void CPU::power_on() {
+    cycles = 0;
+    instructions = 0;
+    deadline = 0;
+    branch_taken = false;
+    halted = false;
+    stopped = false;
+    breakpoint = false;
+    idle_skipped = 0;
+#ifdef GBEMU_TRACE
+    trace.clear();
+    trace_saved = false;
+#endif
+    ime = false;
+    ei_delay = false;
+    irq_check = Scheduler::NEVER;
+    gbmemory.clock = &cycles;
+    gbmemory.irq_check = &irq_check;
+    gbmemory.ime = &ime;
+    gbmemory.ei_delay = &ei_delay;
+    for (std::size_t i = 0; i < FUSED_COUNT; i++) {
+        fused_hits[i] = 0;
+    }
     registers.A = 0x01;
     registers.B = 0x00;
     registers.C = 0x13;
     registers.D = 0x00;
     registers.E = 0xD8;
     registers.F = 0xB0;
+    lazy.op = FLAGS_NONE;
     registers.H = 0x01;
     registers.L = 0x4D;
     registers.SP = 0xFFFE;
     registers.PC = 0x100;
 }
 
-uint16_t CPU::swap_endian(uint16_t bytes) {
-    return (bytes << 8) | (bytes >> 8);
-}
-
-// For use with memory::get_memory, pass in little endian order
-uint16_t CPU::concat_regist(uint8_t most, uint8_t least) {
-    return (uint16_t)((most << 8) | least);
-}
+// Fetch, decode and execute one instruction.
+// Returns the number of T-cycles it took.
+template<typename Timing>
+unsigned CPU::step() {
+    uint64_t before = cycles;
 
-// Decrementing 8-bit combined register
-void CPU::dec_16bit(uint8_t& most, uint8_t& least) {
-    uint16_t dec = concat_regist(most, least) - 0x1;
-    most = (uint8_t)(dec >> 8);
-    least = (uint8_t)dec;
-}
+    if (cycles >= irq_check)
+        check_interrupts<Timing>();
 
-// Decrementing true 16-bit register
-void CPU::dec_16bit(uint16_t& reg) {
-    reg = swap_endian(reg - 1);
-}
+    if (halted) {
+        uint64_t next = gbmemory.next_event();
 
-// Incrementing 8-bit combined register
-void CPU::inc_16bit(uint8_t& most, uint8_t& least) {
-    uint16_t dec = concat_regist(most, least) + 0x1;
-    most = (uint8_t)(dec >> 8);
-    least = (uint8_t)dec;
-}
+        idle(next == Scheduler::NEVER ? cycles + 4 : next);
+        return (unsigned)(cycles - before);
+    }
 
-// Incrementing true 16-bit register
-void CPU::inc_16bit(uint16_t& reg) {
-    reg = swap_endian(swap_endian(reg) + 1);
-}
+    uint16_t pc = registers.PC;
+    uint64_t start = cycles;
+    uint8_t opcode = read_memory<Timing>(pc);
+    uint16_t arg = 0;
 
-///////////////////////
-// OP code functions //
-///////////////////////
-void CPU::op_Load(uint8_t opcode, uint16_t arg) {
-    uint8_t oldL;
-    uint16_t SPn;
-
-    switch (opcode) {
-    case (0x01):
-        registers.B = (uint8_t)(arg >> 8);
-        registers.C = (uint8_t)arg;
-        break;
-    case (0x02):
-        gbmemory.set_memory(concat_regist(registers.C, registers.B), registers.A);
-        break;
-    case (0x06):
-        registers.B = (uint8_t)arg;
-        break;
-    case (0x08):
-        registers.SP = arg;
-        break;
-    case (0x0A):
-        registers.A = gbmemory.get_memory(concat_regist(registers.C, registers.B));
-        break;
-    case (0x0E):
-        registers.C = (uint8_t)arg;
-        break;
-    case (0x11):
-        registers.D = (uint8_t)(arg >> 8);
-        registers.E = (uint8_t)arg;
-        break;
-    case (0x12):
-        gbmemory.set_memory(concat_regist(registers.E, registers.D), registers.A);
-        break;
-    case (0x16):
-        registers.D = (uint8_t)arg;
-        break;
-    case (0x1A):
-        registers.A = gbmemory.get_memory(concat_regist(registers.E, registers.D));
-        break;
-    case (0x1E):
-        registers.E = (uint8_t)arg;
-        break;
-    case (0x21):
-        registers.H = (uint8_t)(arg >> 8);
-        registers.L = (uint8_t)arg;
-        break;
-    case (0x22):
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), registers.A);
-        inc_16bit(registers.H, registers.L);
-        break;
-    case (0x26):
-        registers.H = (uint8_t)arg;
-        break;
-    case (0x2A):
-        registers.A = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        inc_16bit(registers.H, registers.L);
-        break;
-    case (0x2E):
-        registers.L = (uint8_t)arg;
-        break;
-    case (0x31):
-        registers.SP = arg;
-        break;
-    case (0x32):
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), registers.A);
-        dec_16bit(registers.H, registers.L);
-        break;
-    case (0x36):
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), (uint8_t)arg);
-        break;
-    case (0x3A):
-        registers.A = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        dec_16bit(registers.H, registers.L);
-        break;
-    case (0x3E):
-        registers.A = (uint8_t)arg;
-        break;
-    case (0x40):
-        registers.B = registers.B;
-        break;
-    case (0x41):
-        registers.B = registers.C;
-        break;
-    case (0x42):
-        registers.B = registers.D;
-        break;
-    case (0x43):
-        registers.B = registers.E;
-        break;
-    case (0x44):
-        registers.B = registers.H;
-        break;
-    case (0x45):
-        registers.B = registers.L;
-        break;
-    case (0x46):
-        registers.B = gbmemory.get_memory(concat_regist(registers.L, registers.H));
+    switch (op_info[opcode].length) {
+    case (2):
+        arg = read_memory<Timing>(pc + 1);
         break;
-    case (0x47):
-        registers.B = registers.A;
+    case (3):
+        arg = read_memory<Timing>(pc + 1);
+        arg |= read_memory<Timing>(pc + 2) << 8;
         break;
-    case (0x48):
-        registers.C = registers.B;
-        break;
-    case (0x49):
-        registers.C = registers.C;
-        break;
-    case (0x4A):
-        registers.C = registers.D;
-        break;
-    case (0x4B):
-        registers.C = registers.E;
-        break;
-    case (0x4C):
-        registers.C = registers.H;
-        break;
-    case (0x4D):
-        registers.C = registers.L;
-        break;
-    case (0x4E):
-        registers.C = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        break;
-    case (0x4F):
-        registers.C = registers.A;
-        break;
-    case (0x50):
-        registers.D = registers.B;
-        break;
-    case (0x51):
-        registers.D = registers.C;
-        break;
-    case (0x52):
-        registers.D = registers.D;
-        break;
-    case (0x53):
-        registers.D = registers.E;
-        break;
-    case (0x54):
-        registers.D = registers.H;
-        break;
-    case (0x55):
-        registers.D = registers.L;
-        break;
-    case (0x56):
-        registers.D = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        break;
-    case (0x57):
-        registers.D = registers.A;
-        break;
-    case (0x58):
-        registers.E = registers.B;
-        break;
-    case (0x59):
-        registers.E = registers.C;
-        break;
-    case (0x5A):
-        registers.E = registers.D;
-        break;
-    case (0x5B):
-        registers.E = registers.E;
-        break;
-    case (0x5C):
-        registers.E = registers.H;
-        break;
-    case (0x5D):
-        registers.E = registers.L;
-        break;
-    case (0x5E):
-        registers.E = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        break;
-    case (0x5F):
-        registers.E = registers.A;
-        break;
-    case (0x60):
-        registers.H = registers.B;
-        break;
-    case (0x61):
-        registers.H = registers.C;
-        break;
-    case (0x62):
-        registers.H = registers.D;
-        break;
-    case (0x63):
-        registers.H = registers.E;
-        break;
-    case (0x64):
-        registers.H = registers.H;
-        break;
-    case (0x65):
-        registers.H = registers.L;
-        break;
-    case (0x66):
-        registers.H = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        break;
-    case (0x67):
-        registers.H = registers.A;
-        break;
-    case (0x68):
-        registers.L = registers.B;
-        break;
-    case (0x69):
-        registers.L = registers.C;
-        break;
-    case (0x6A):
-        registers.L = registers.D;
-        break;
-    case (0x6B):
-        registers.L = registers.E;
-        break;
-    case (0x6C):
-        registers.L = registers.H;
-        break;
-    case (0x6D):
-        registers.L = registers.L;
-        break;
-    case (0x6E):
-        registers.L = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        break;
-    case (0x6F):
-        registers.L = registers.A;
-        break;
-    case (0x70):
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), registers.B);
-        break;
-    case (0x71):
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), registers.C);
-        break;
-    case (0x72):
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), registers.D);
-        break;
-    case (0x73):
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), registers.E);
-        break;
-    case (0x74):
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), registers.H);
-        break;
-    case (0x75):
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), registers.L);
-        break;
-    case (0x77):
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), registers.A);
-        break;
-    case (0x78):
-        registers.A = registers.B;
-        break;
-    case (0x79):
-        registers.A = registers.C;
-        break;
-    case (0x7A):
-        registers.A = registers.D;
-        break;
-    case (0x7B):
-        registers.A = registers.E;
-        break;
-    case (0x7C):
-        registers.A = registers.H;
-        break;
-    case (0x7D):
-        registers.A = registers.L;
-        break;
-    case (0x7E):
-        registers.A = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        break;
-    case (0x7F):
-        registers.A = registers.A;
-        break;
-    case (0xE0):
-        registers.A = gbmemory.get_memory(swap_endian(0xFF00 + (uint8_t)arg));
-        break;
-    case (0xE2):
-        gbmemory.set_memory(swap_endian(0xFF00 + registers.C), registers.A);
-        break;
-    case (0xEA):
-        gbmemory.set_memory(swap_endian(arg), registers.A);
-        break;
-    case (0xF0):
-        gbmemory.set_memory(swap_endian(0xFF00 + (uint8_t)arg), registers.A);
-        break;
-    case (0xF2):
-        registers.A = gbmemory.get_memory(swap_endian(0xFF00 + registers.C));
+    default:
         break;
-    case (0xF8):
-        SPn = registers.SP + arg;
-        oldL = registers.L;
+    }
 
-        registers.H = (uint8_t)(SPn >> 8);
-        registers.L = (uint8_t)SPn;
-        registers.F = registers.F &= ~FLAG_ZERO;
-        registers.F = registers.F &= ~FLAG_ADSB;
+    // PC points at the next instruction while the handler runs,
+    // so relative jumps and pushed return addresses come out right
+#ifdef GBEMU_TRACE
+    trace_op(pc, opcode, arg);
+#endif
+    registers.PC = pc + op_info[opcode].length;
+    branch_taken = false;
 
-        if (SPn < arg)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+    (this->*(Timing::per_access ? mcycle_opcodes : opcodes)[opcode])(arg);
 
-        if (oldL > registers.L)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
+    uint8_t taken = branch_taken ? op_info[opcode].cycles_branch : op_info[opcode].cycles;
 
-        break;
-    case (0xF9):
-        registers.SP = concat_regist(registers.H, registers.L);
-        break;
-    case (0xFA):
-        registers.A = gbmemory.get_memory(swap_endian(arg));
-        break;
-    default:
-        break;
+    if constexpr (Timing::per_access) {
+        // Whatever the accesses didn't take is internal M-cycles at the end
+        if (cycles < start + taken)
+            cycles = start + taken;
     }
+    else {
+        cycles += taken;
+    }
+    instructions++;
+#ifdef GBEMU_PROFILE
+    profiler.record(gbmemory.rom_bank, pc, opcode, (uint32_t)(cycles - start));
+#endif
+    return (unsigned)(cycles - before);
 }
 
-void CPU::op_Push(uint8_t opcode, uint16_t arg) {
-    switch (opcode) {
-    case (0xC5):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(registers.SP, registers.B);
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(registers.SP, registers.C);
-        break;
-    case (0xD5):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(registers.SP, registers.D);
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(registers.SP, registers.E);
-        break;
-    case (0xE5):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(registers.SP, registers.H);
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(registers.SP, registers.L);
-        break;
-    case (0xF5):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(registers.SP, registers.A);
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(registers.SP, registers.F);
-        break;
-    default:
-        break;
+template unsigned CPU::step<CPU::instructionTiming>();
+template unsigned CPU::step<CPU::mcycleTiming>();
+
+// Execute instructions until at least `budget` T-cycles have elapsed.
+// Returns the number of T-cycles actually run, which can overshoot
+// the budget by up to one instruction. Interrupts are only looked at
+// once irq_check is reached, so each run loop stops what it's doing
+// there (or at the target, if that's sooner).
+uint64_t CPU::run_for(uint64_t budget) {
+    uint64_t start = cycles;
+    uint64_t target = start + budget;
+
+    deadline = target;
+    if (core == CORE_MCYCLE) {
+        while (cycles < target) {
+            if (halted)
+                idle(target);
+            else
+                step<mcycleTiming>();
+        }
+        return cycles - start;
+    }
+    if (core == CORE_JIT) {
+        run_jit(target);
+        return cycles - start;
+    }
+    if (core == CORE_BLOCKS) {
+        run_blocks(target);
+        return cycles - start;
     }
-}
 
-void CPU::op_Pop(uint8_t opcode, uint16_t arg) {
-    switch (opcode) {
-    case (0xC1):
-        registers.C = gbmemory.get_memory(registers.SP);
-        inc_16bit(registers.SP);
-        registers.B = gbmemory.get_memory(registers.SP);
-        inc_16bit(registers.SP);
-        break;
-    case (0xD1):
-        registers.E = gbmemory.get_memory(registers.SP);
-        inc_16bit(registers.SP);
-        registers.D = gbmemory.get_memory(registers.SP);
-        inc_16bit(registers.SP);
-        break;
-    case (0xE1):
-        registers.L = gbmemory.get_memory(registers.SP);
-        inc_16bit(registers.SP);
-        registers.H = gbmemory.get_memory(registers.SP);
-        inc_16bit(registers.SP);
-        break;
-    case (0xF1):
-        registers.F = gbmemory.get_memory(registers.SP);
-        inc_16bit(registers.SP);
-        registers.A = gbmemory.get_memory(registers.SP);
-        inc_16bit(registers.SP);
-        break;
-    default:
-        break;
+#ifdef GBEMU_THREADED_DISPATCH
+    while (cycles < target) {
+        if (halted)
+            idle(target);
+        else if (cycles >= irq_check)
+            step();
+        else
+            run_threaded(target);
+    }
+#else
+    while (cycles < target) {
+        if (halted)
+            idle(target);
+        else
+            step();
     }
+#endif
+    return cycles - start;
 }
 
-void CPU::op_Add(uint8_t opcode, uint16_t arg) {
-    uint8_t oldA, get;
-    uint16_t oldHL, HL, oldSP;
-    bool carry;
+// run_for() over cached blocks
+void CPU::run_blocks(uint64_t target) {
+    while (cycles < target) {
+        // As in run_for(): a stopped CPU only wakes on the joypad, even
+        // with an interrupt serviceable
+        if (halted) {
+            idle(target);
+            continue;
+        }
+        if (cycles >= irq_check)
+            check_interrupts();
+        if (!BlockCache::cacheable(registers.PC)) {
+            step();
+            continue;
+        }
+        if (gbmemory.exit_blocks)
+            blocks.flush_dirty(gbmemory);
+
+        BlockCache::block& b = blocks.lookup(gbmemory, registers.PC);
+        uint64_t limit = irq_check < target ? irq_check : target;
+
+        deadline = limit;
+        gbmemory.polled = 0x00;
+        run_block(b, limit);
+        if (b.loop_cycles != 0 && registers.PC == b.start && cycles < limit)
+            idle_loop(b, limit);
+    }
+}
 
-    switch (opcode) {
-    case (0x09):
-        oldHL = concat_regist(registers.H, registers.L);
-        HL = oldHL;
+// Run one cached block. Handlers see the same PC as in step(), and the
+// block is left early once the target is reached, code it may have
+// been decoded from gets overwritten, or IE/IF are written.
+void CPU::run_block(const BlockCache::block& b, uint64_t target) {
+    for (const BlockCache::microOp& op : b.ops) {
+#ifdef GBEMU_TRACE
+        trace_op(registers.PC, op.opcode, op.arg);
+#endif
+#ifdef GBEMU_PROFILE
+        uint16_t pc = registers.PC;
+        uint64_t at = cycles;
+#endif
+        registers.PC += op.len;
+        branch_taken = false;
+
+        (this->*op.fn)(op.arg);
+
+        cycles += branch_taken ? op.cycles_branch : op.cycles;
+        // Fused handlers count their own, however far they got
+        instructions += op.fused == BlockCache::NOT_FUSED;
+#ifdef GBEMU_PROFILE
+        profiler.record(gbmemory.rom_bank, pc, op.opcode, (uint32_t)(cycles - at));
+#endif
+        if (cycles >= target || gbmemory.exit_blocks)
+            break;
+    }
+}
 
-        if ((registers.F & FLAG_CARY) > 0x0)
-            HL = concat_regist(registers.B, registers.C) + 0x1;
-        else
-            HL = concat_regist(registers.B, registers.C);
+// run_blocks(), but ROM blocks run often enough get compiled. Compiled
+// code runs a whole block at a time, so it's only used when the block
+// can't reach the target; the last few cycles are interpreted instead.
+void CPU::run_jit(uint64_t target) {
+    while (cycles < target) {
+        if (halted) {
+            idle(target);
+            continue;
+        }
+        if (cycles >= irq_check)
+            check_interrupts();
+        if (!BlockCache::cacheable(registers.PC)) {
+            step();
+            continue;
+        }
+        if (gbmemory.exit_blocks)
+            blocks.flush_dirty(gbmemory);
 
-        registers.H = (uint8_t)(HL >> 8);
-        registers.L = (uint8_t)HL;
+        BlockCache::block& b = blocks.lookup(gbmemory, registers.PC);
 
-        if (HL == 0x0)
-            registers.F |= FLAG_ZERO;
+#ifndef GBEMU_EVERY_OP
+        // Native code would hide its instructions from the profiler/trace
+        if (b.code == nullptr && b.start < 0x8000 && ++b.hits == Jit::HOT_THRESHOLD)
+            jit.compile(*this, b);
+#endif
 
-        registers.F &= ~FLAG_ADSB;
+        uint64_t limit = irq_check < target ? irq_check : target;
 
-        if (oldHL > HL)
-            registers.F |= FLAG_CARY;
+        deadline = limit;
+        gbmemory.polled = 0x00;
+        if (b.code != nullptr && cycles + b.max_cycles < limit)
+            b.code(this, limit);
         else
-            registers.F &= ~FLAG_CARY;
+            run_block(b, limit);
 
-        if (registers.L < (uint8_t)oldHL)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x19):
-        oldHL = concat_regist(registers.H, registers.L);
-        HL = oldHL;
+        if (b.loop_cycles != 0 && registers.PC == b.start && cycles < limit)
+            idle_loop(b, limit);
+    }
+}
 
-        if ((registers.F & FLAG_CARY) > 0x0)
-            HL = concat_regist(registers.D, registers.E) + 0x1;
-        else
-            HL = concat_regist(registers.D, registers.E);
+// Skip a halted CPU straight to the next cycle anything could wake it,
+// one scheduled event at a time, until it wakes or `target` is reached.
+// Something may already be pending (e.g. a button pressed since), which
+// wakes it without skipping anything. Waking looks at interrupts before
+// the next instruction, irq_check being from before the HALT.
+void CPU::idle(uint64_t target) {
+    uint8_t wake = stopped ? Scheduler::IRQ_JOYPAD : 0x1F;
 
-        registers.H = (uint8_t)(HL >> 8);
-        registers.L = (uint8_t)HL;
+    for (;;) {
+        gbmemory.sync_events();
 
-        if (HL == 0x0)
-            registers.F |= FLAG_ZERO;
+        if (gbmemory.pending_interrupts() & wake) {
+            halted = false;
+            stopped = false;
+            irq_check = cycles;
+            return;
+        }
+        if (cycles >= target)
+            return;
 
-        registers.F &= ~FLAG_ADSB;
+        uint64_t next = gbmemory.next_event();
 
-        if (oldHL > HL)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+        cycles = next < target ? next : target;
+    }
+}
 
-        if (registers.L < (uint8_t)oldHL)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x29):
-        oldHL = concat_regist(registers.H, registers.L);
-        HL = oldHL;
+// Between instructions: finish an EI, or jump to the highest priority
+// interrupt that's requested and enabled (VBlank first, joypad last).
+// Then work out when anything could next need servicing: only an IF
+// bit being raised, while IME is on. IE/IF writes, EI and RETI bring
+// irq_check forward to look again straight away.
+template<typename Timing>
+void CPU::check_interrupts() {
+    if (ei_delay) {
+        // One more instruction first
+        ei_delay = false;
+        ime = true;
+        irq_check = cycles + 1;
+        return;
+    }
 
-        if ((registers.F & FLAG_CARY) > 0x0)
-            HL = concat_regist(registers.H, registers.L) + 0x1;
-        else
-            HL = concat_regist(registers.H, registers.L);
+    gbmemory.sync_events();
+    uint8_t pending = gbmemory.pending_interrupts();
 
-        registers.H = (uint8_t)(HL >> 8);
-        registers.L = (uint8_t)HL;
+    if (ime && pending) {
+        uint8_t irq = 0;
 
-        if (HL == 0x0)
-            registers.F |= FLAG_ZERO;
+        while (!(pending & (1 << irq))) {
+            irq++;
+        }
 
-        registers.F &= ~FLAG_ADSB;
+        // Two internal M-cycles, the return address, then one to jump
+        uint64_t start = cycles;
 
-        if (oldHL > HL)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+        gbmemory.acknowledge(1 << irq);
+        ime = false;
+        halted = false;
+        stopped = false;
+        internal_cycle<Timing>();
+        internal_cycle<Timing>();
+        push_16bit<Timing>(registers.PC);
+        registers.PC = 0x40 + irq * 8;
+        cycles = start + 20;
+    }
 
-        if (registers.L < (uint8_t)oldHL)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x39):
-        oldHL = concat_regist(registers.H, registers.L);
-        HL = oldHL;
+    irq_check = ime ? gbmemory.next_event() : Scheduler::NEVER;
+}
 
-        if ((registers.F & FLAG_CARY) > 0x0)
-            HL = registers.SP + 0x1;
-        else
-            HL = registers.SP;
+#ifdef GBEMU_TRACE
+// Record the state an instruction at pc is about to run in
+void CPU::trace_op(uint16_t pc, uint8_t opcode, uint16_t arg) {
+    Trace::record r;
+
+    r.cycles = cycles;
+    r.pc = pc;
+    r.sp = registers.SP;
+    r.af = registers.A << 8 | get_F();
+    r.bc = registers.BC;
+    r.de = registers.DE;
+    r.hl = registers.HL;
+    r.arg = arg;
+    r.opcode = opcode;
+    r.bank = pc >= 0x4000 && pc < 0x8000 ? (uint8_t)gbmemory.rom_bank : 0;
+    trace.add(r);
+}
+#endif
+
+// b has just gone round once. Run it again, and if that pass left every
+// register as it found them, the passes after it will too for as long
+// as the I/O registers it read don't change and no interrupt is raised:
+// skip them all at once. Loops that keep changing state, like counters,
+// stop being checked after a few tries.
+void CPU::idle_loop(BlockCache::block& b, uint64_t target) {
+    uint8_t sources = gbmemory.polled;
+    uint64_t until = gbmemory.next_change(sources | Scheduler::SOURCE_IRQ);
+    uint64_t start = cycles;
+    uint8_t f = get_F();
+    uint16_t bc = registers.BC, de = registers.DE, hl = registers.HL, sp = registers.SP;
+    uint8_t a = registers.A;
+
+    gbmemory.polled = 0x00;
+    run_block(b, target);
+
+    if (registers.PC != b.start || cycles - start != b.loop_cycles || (gbmemory.polled & ~sources))
+        return;
+    if (registers.A != a || get_F() != f || registers.BC != bc || registers.DE != de || registers.HL != hl || registers.SP != sp) {
+        if (++b.loop_misses == BlockCache::MAX_LOOP_MISSES)
+            b.loop_cycles = 0;
+        return;
+    }
 
-        registers.H = (uint8_t)(HL >> 8);
-        registers.L = (uint8_t)HL;
+    b.loop_misses = 0;
+    skip_passes(b.loop_cycles, (uint32_t)b.ops.size(), until);
+}
 
-        if (HL == 0x0)
-            registers.F |= FLAG_ZERO;
+// Jump over as many whole `length`-cycle passes of an idle loop, `ops`
+// instructions each, as end by `until`, when what they read next
+// changes, and by the deadline. The reads in a pass all happen before
+// it ends, so none of the skipped ones could have seen a different value.
+void CPU::skip_passes(uint32_t length, uint32_t ops, uint64_t until) {
+    if (deadline < until)
+        until = deadline;
+    if (until <= cycles)
+        return;
+
+    uint64_t passes = (until - cycles) / length;
+
+    cycles += passes * length;
+    instructions += passes * ops;
+    idle_skipped += passes * length;
+}
 
-        registers.F &= ~FLAG_ADSB;
+// step() for one known OP code: the length and timing lookups fold
+// to constants, leaving only the handler call
+template<uint8_t Op>
+void CPU::execute() {
+    constexpr opInfo info = op_info[Op];
+    uint16_t pc = registers.PC;
+    uint16_t arg = 0;
+
+    if (info.length == 2)
+        arg = gbmemory.get_memory(pc + 1);
+    else if (info.length == 3)
+        arg = gbmemory.get_memory(pc + 1) | (gbmemory.get_memory(pc + 2) << 8);
+
+#ifdef GBEMU_TRACE
+    trace_op(pc, Op, arg);
+#endif
+    registers.PC = pc + info.length;
+    branch_taken = false;
+#ifdef GBEMU_PROFILE
+    uint64_t at = cycles;
+#endif
+
+    (this->*decode_op<Op>())(arg);
+
+    cycles += branch_taken ? info.cycles_branch : info.cycles;
+    instructions++;
+#ifdef GBEMU_PROFILE
+    profiler.record(gbmemory.rom_bank, pc, Op, (uint32_t)(cycles - at));
+#endif
+}
 
-        if (oldHL > HL)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+#ifdef GBEMU_THREADED_DISPATCH
+// clang-format off
+#define OP_ROW(X, h) X(h##0) X(h##1) X(h##2) X(h##3) X(h##4) X(h##5) X(h##6) X(h##7) \
+                     X(h##8) X(h##9) X(h##A) X(h##B) X(h##C) X(h##D) X(h##E) X(h##F)
+#define OP_ALL(X) OP_ROW(X, 0) OP_ROW(X, 1) OP_ROW(X, 2) OP_ROW(X, 3) \
+                  OP_ROW(X, 4) OP_ROW(X, 5) OP_ROW(X, 6) OP_ROW(X, 7) \
+                  OP_ROW(X, 8) OP_ROW(X, 9) OP_ROW(X, A) OP_ROW(X, B) \
+                  OP_ROW(X, C) OP_ROW(X, D) OP_ROW(X, E) OP_ROW(X, F)
+#define OP_LABEL(n) &&op_##n,
+#define OP_BODY(n) op_##n: execute<0x##n>(); if ((0x##n == 0x76 || 0x##n == 0x10) && halted) return; DISPATCH();
+#define DISPATCH()                                       \
+    do {                                                 \
+        if (cycles >= target || cycles >= irq_check)     \
+            return;                                      \
+        goto* labels[gbmemory.get_memory(registers.PC)]; \
+    } while (0)
+// clang-format on
+
+// Threaded-code interpreter: each OP code's body jumps straight to the
+// next one, giving the branch predictor one dispatch site per handler
+void CPU::run_threaded(uint64_t target) {
+    static void* const labels[0x100] = {OP_ALL(OP_LABEL)};
+
+    DISPATCH();
+    OP_ALL(OP_BODY)
+}
 
-        if (registers.L < (uint8_t)oldHL)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x80):
-        oldA = registers.A;
-        registers.A += registers.B;
+#undef DISPATCH
+#undef OP_BODY
+#undef OP_LABEL
+#undef OP_ALL
+#undef OP_ROW
+#endif
+
+// Memory as handlers see it. With mcycleTiming each access ends its own
+// M-cycle, so timed registers are read and written on the cycle the
+// hardware does it; with instructionTiming they all happen at the
+// instruction's start and step() adds its cycles afterwards.
+template<typename Timing>
+uint8_t CPU::read_memory(uint16_t addr) {
+    if constexpr (Timing::per_access)
+        cycles += 4;
+    return gbmemory.get_memory(addr);
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+template<typename Timing>
+void CPU::write_memory(uint16_t addr, uint8_t val) {
+    if constexpr (Timing::per_access)
+        cycles += 4;
+    gbmemory.set_memory(addr, val);
+}
 
-        registers.F &= ~FLAG_ADSB;
+// An M-cycle without a memory access, where one comes before accesses
+// that follow it
+template<typename Timing>
+void CPU::internal_cycle() {
+    if constexpr (Timing::per_access)
+        cycles += 4;
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+// Stack grows downwards, most significant byte is pushed first
+template<typename Timing>
+void CPU::push_16bit(uint16_t val) {
+    write_memory<Timing>(--registers.SP, (uint8_t)(val >> 8));
+    write_memory<Timing>(--registers.SP, (uint8_t)val);
+}
 
-        if ((oldA & 0xF) + (registers.B & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x81):
-        oldA = registers.A;
-        registers.A += registers.C;
+template<typename Timing>
+uint16_t CPU::pop_16bit() {
+    uint8_t least = read_memory<Timing>(registers.SP++);
+    uint8_t most = read_memory<Timing>(registers.SP++);
+    return (uint16_t)((most << 8) | least);
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+////////////////////////
+// Operand decoding   //
+////////////////////////
+
+// 8-bit register field: B C D E H L (HL) A
+template<uint8_t R, typename Timing>
+uint8_t CPU::read_r8() {
+    if constexpr (R == 0)
+        return registers.B;
+    else if constexpr (R == 1)
+        return registers.C;
+    else if constexpr (R == 2)
+        return registers.D;
+    else if constexpr (R == 3)
+        return registers.E;
+    else if constexpr (R == 4)
+        return registers.H;
+    else if constexpr (R == 5)
+        return registers.L;
+    else if constexpr (R == 6)
+        return read_memory<Timing>(registers.HL);
+    else
+        return registers.A;
+}
 
-        registers.F &= ~FLAG_ADSB;
+template<uint8_t R, typename Timing>
+void CPU::write_r8(uint8_t val) {
+    if constexpr (R == 0)
+        registers.B = val;
+    else if constexpr (R == 1)
+        registers.C = val;
+    else if constexpr (R == 2)
+        registers.D = val;
+    else if constexpr (R == 3)
+        registers.E = val;
+    else if constexpr (R == 4)
+        registers.H = val;
+    else if constexpr (R == 5)
+        registers.L = val;
+    else if constexpr (R == 6)
+        write_memory<Timing>(registers.HL, val);
+    else
+        registers.A = val;
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+// 16-bit register pair field: BC DE HL SP
+// PUSH/POP use AF in place of SP, passed as 4
+template<uint8_t P>
+uint16_t CPU::read_rp() {
+    if constexpr (P == 0)
+        return registers.BC;
+    else if constexpr (P == 1)
+        return registers.DE;
+    else if constexpr (P == 2)
+        return registers.HL;
+    else if constexpr (P == 3)
+        return registers.SP;
+    else {
+        get_F();
+        return registers.AF;
+    }
+}
 
-        if ((oldA & 0xF) + (registers.C & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x82):
-        oldA = registers.A;
-        registers.A += registers.D;
+template<uint8_t P>
+void CPU::write_rp(uint16_t val) {
+    if constexpr (P == 0)
+        registers.BC = val;
+    else if constexpr (P == 1)
+        registers.DE = val;
+    else if constexpr (P == 2)
+        registers.HL = val;
+    else if constexpr (P == 3)
+        registers.SP = val;
+    else {
+        registers.AF = val & 0xFFF0;
+        lazy.op = FLAGS_NONE;
+    }
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+// Condition field: NZ Z NC C
+template<uint8_t CC>
+bool CPU::condition() {
+    if constexpr (CC == 0)
+        return !zero_flag();
+    else if constexpr (CC == 1)
+        return zero_flag();
+    else if constexpr (CC == 2)
+        return !carry_flag();
+    else
+        return carry_flag();
+}
 
-        registers.F &= ~FLAG_ADSB;
+// Register or immediate source operand of the 8-bit ALU group
+template<uint8_t Op, typename Timing>
+uint8_t CPU::alu_operand(uint16_t arg) {
+    if constexpr ((Op >> 6) == 3)
+        return (uint8_t)arg;
+    else
+        return read_r8<Op & 0x7, Timing>();
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+////////////////////////
+// Flags              //
+////////////////////////
 
-        if ((oldA & 0xF) + (registers.D & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
+// Work out F from the last recorded ALU operation, see alu_tables
+uint8_t CPU::get_F() {
+    switch (lazy.op) {
+    case (FLAGS_ADD):
+        registers.F = alu_tables.add[lazy.carry][lazy.a][lazy.b];
+        break;
+    case (FLAGS_SUB):
+        registers.F = alu_tables.sub[lazy.carry][lazy.a][lazy.b];
+        break;
+    case (FLAGS_AND):
+        registers.F = (lazy.res == 0x0 ? FLAG_ZERO : 0x0) | FLAG_HALF;
+        break;
+    case (FLAGS_OR):
+        registers.F = lazy.res == 0x0 ? FLAG_ZERO : 0x0;
+        break;
+    case (FLAGS_INC):
+        registers.F = alu_tables.inc[lazy.res] | (lazy.carry ? FLAG_CARY : 0x0);
+        break;
+    case (FLAGS_DEC):
+        registers.F = alu_tables.dec[lazy.res] | (lazy.carry ? FLAG_CARY : 0x0);
+        break;
+    default:
         break;
-    case (0x83):
-        oldA = registers.A;
-        registers.A += registers.E;
+    }
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+    lazy.op = FLAGS_NONE;
+    return registers.F;
+}
 
-        registers.F &= ~FLAG_ADSB;
+void CPU::set_F(uint8_t val) {
+    registers.F = val;
+    lazy.op = FLAGS_NONE;
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+// Single flags for conditional branches, without building all of F
+bool CPU::zero_flag() {
+    if (lazy.op == FLAGS_NONE)
+        return (registers.F & FLAG_ZERO) > 0x0;
+    return lazy.res == 0x0;
+}
 
-        if ((oldA & 0xF) + (registers.E & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x84):
-        oldA = registers.A;
-        registers.A += registers.H;
+bool CPU::carry_flag() {
+    switch (lazy.op) {
+    case (FLAGS_NONE):
+        return (registers.F & FLAG_CARY) > 0x0;
+    case (FLAGS_ADD):
+        return (alu_tables.add[lazy.carry][lazy.a][lazy.b] & FLAG_CARY) > 0x0;
+    case (FLAGS_SUB):
+        return (alu_tables.sub[lazy.carry][lazy.a][lazy.b] & FLAG_CARY) > 0x0;
+    case (FLAGS_INC):
+    case (FLAGS_DEC):
+        return lazy.carry > 0x0;
+    default:
+        return false;
+    }
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+////////////////////////
+// 8-bit ALU          //
+////////////////////////
+uint8_t CPU::alu_add(uint8_t a, uint8_t b, uint8_t carry) {
+    uint8_t res = a + b + carry;
 
-        registers.F &= ~FLAG_ADSB;
+    lazy = {FLAGS_ADD, a, b, carry, res};
+    return res;
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+uint8_t CPU::alu_sub(uint8_t a, uint8_t b, uint8_t carry) {
+    uint8_t res = a - b - carry;
 
-        if ((oldA & 0xF) + (registers.H & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x85):
-        oldA = registers.A;
-        registers.A += registers.L;
+    lazy = {FLAGS_SUB, a, b, carry, res};
+    return res;
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+uint8_t CPU::alu_and(uint8_t a, uint8_t b) {
+    uint8_t res = a & b;
 
-        registers.F &= ~FLAG_ADSB;
+    lazy.op = FLAGS_AND;
+    lazy.res = res;
+    return res;
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+uint8_t CPU::alu_or(uint8_t a, uint8_t b) {
+    uint8_t res = a | b;
 
-        if ((oldA & 0xF) + (registers.L & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x86):
-        oldA = registers.A;
-        registers.A += gbmemory.get_memory(concat_regist(registers.L, registers.H));
+    lazy.op = FLAGS_OR;
+    lazy.res = res;
+    return res;
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+uint8_t CPU::alu_xor(uint8_t a, uint8_t b) {
+    uint8_t res = a ^ b;
 
-        registers.F &= ~FLAG_ADSB;
+    lazy.op = FLAGS_OR;
+    lazy.res = res;
+    return res;
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+///////////////////////
+// OP code functions //
+///////////////////////
 
-        if ((oldA & 0xF) + (gbmemory.get_memory(concat_regist(registers.L, registers.H)) & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x87):
-        oldA = registers.A;
-        registers.A += registers.A;
+template<uint8_t Op, typename Timing>
+void CPU::op_Load(uint16_t arg) {
+    constexpr uint8_t y = (Op >> 3) & 0x7;
+    constexpr uint8_t z = Op & 0x7;
+    constexpr uint8_t p = y >> 1;
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if ((oldA & 0xF) + (oldA & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x88):
-        oldA = registers.A;
-        carry = false;
+    if constexpr (Op == 0x08) {
+        // LD (nn), SP
+        write_memory<Timing>(arg, (uint8_t)registers.SP);
+        write_memory<Timing>(arg + 1, (uint8_t)(registers.SP >> 8));
+    }
+    else if constexpr ((Op >> 6) == 0 && z == 1) {
+        // LD rr, nn
+        write_rp<p>(arg);
+    }
+    else if constexpr ((Op >> 6) == 0 && z == 2) {
+        // LD (BC)/(DE)/(HL+)/(HL-), A and back
+        uint16_t addr = read_rp<(p < 2 ? p : 2)>();
 
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A += (registers.B + 0x1);
-            carry = true;
-        }
+        if constexpr ((y & 0x1) == 0)
+            write_memory<Timing>(addr, registers.A);
         else
-            registers.A += registers.B;
+            registers.A = read_memory<Timing>(addr);
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+        if constexpr (p == 2)
+            registers.HL++;
+        else if constexpr (p == 3)
+            registers.HL--;
+    }
+    else if constexpr ((Op >> 6) == 0 && z == 6) {
+        // LD r, n
+        write_r8<y, Timing>((uint8_t)arg);
+    }
+    else if constexpr ((Op >> 6) == 1) {
+        // LD r, r'
+        write_r8<y, Timing>(read_r8<z, Timing>());
+        if constexpr (Op == 0x40)
+            breakpoint = true;
+    }
+    else if constexpr (Op == 0xE0) {
+        write_memory<Timing>(0xFF00 + (uint8_t)arg, registers.A);
+    }
+    else if constexpr (Op == 0xF0) {
+        registers.A = read_memory<Timing>(0xFF00 + (uint8_t)arg);
+    }
+    else if constexpr (Op == 0xE2) {
+        write_memory<Timing>(0xFF00 + registers.C, registers.A);
+    }
+    else if constexpr (Op == 0xF2) {
+        registers.A = read_memory<Timing>(0xFF00 + registers.C);
+    }
+    else if constexpr (Op == 0xEA) {
+        write_memory<Timing>(arg, registers.A);
+    }
+    else if constexpr (Op == 0xFA) {
+        registers.A = read_memory<Timing>(arg);
+    }
+    else if constexpr (Op == 0xF8) {
+        // LD HL, SP+n: H and C come from the unsigned low byte add
+        uint8_t n = (uint8_t)arg;
 
-        registers.F &= ~FLAG_ADSB;
+        write_rp<2>(registers.SP + (int8_t)n);
+        set_F(alu_tables.add[0][registers.SP & 0xFF][n] & (FLAG_HALF | FLAG_CARY));
+    }
+    else {
+        // LD SP, HL
+        registers.SP = read_rp<2>();
+    }
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+template<uint8_t Op, typename Timing>
+void CPU::op_Push(uint16_t arg) {
+    constexpr uint8_t p = (Op >> 4) & 0x3;
 
-        if (carry) {
-            if ((oldA & 0xF) + ((registers.B + 0x1) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if ((oldA & 0xF) + ((registers.B) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x89):
-        oldA = registers.A;
-        carry = false;
+    internal_cycle<Timing>();
+    push_16bit<Timing>(read_rp<p == 3 ? 4 : p>());
+}
 
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A += (registers.C + 0x1);
-            carry = true;
-        }
-        else
-            registers.A += registers.C;
+template<uint8_t Op, typename Timing>
+void CPU::op_Pop(uint16_t arg) {
+    constexpr uint8_t p = (Op >> 4) & 0x3;
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+    write_rp<p == 3 ? 4 : p>(pop_16bit<Timing>());
+}
 
-        registers.F &= ~FLAG_ADSB;
+template<uint8_t Op, typename Timing>
+void CPU::op_Add(uint16_t arg) {
+    if constexpr ((Op >> 6) == 0) {
+        // ADD HL, rr: Z is left alone. H and C are the bit 11 and 15
+        // carries, i.e. those of the high byte add, low byte carry in.
+        constexpr uint8_t p = Op >> 4;
+        uint16_t hl = read_rp<2>();
+        uint16_t rr = read_rp<p>();
+        uint8_t low_carry = (hl & 0xFF) + (rr & 0xFF) > 0xFF ? 1 : 0;
+
+        write_rp<2>((uint16_t)(hl + rr));
+        set_F((zero_flag() ? FLAG_ZERO : 0x0) |
+              (alu_tables.add[low_carry][hl >> 8][rr >> 8] & (FLAG_HALF | FLAG_CARY)));
+    }
+    else if constexpr (Op == 0xE8) {
+        // ADD SP, n: H and C come from the unsigned low byte add
+        uint8_t n = (uint8_t)arg;
+        uint16_t sp = registers.SP;
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+        registers.SP = sp + (int8_t)n;
+        set_F(alu_tables.add[0][sp & 0xFF][n] & (FLAG_HALF | FLAG_CARY));
+    }
+    else {
+        // ADD/ADC A, r/n
+        uint8_t carry = (Op & 0x08) && carry_flag() ? 1 : 0;
 
-        if (carry) {
-            if ((oldA & 0xF) + ((registers.C + 0x1) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if ((oldA & 0xF) + ((registers.C) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x8A):
-        oldA = registers.A;
-        carry = false;
+        registers.A = alu_add(registers.A, alu_operand<Op, Timing>(arg), carry);
+    }
+}
 
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A += (registers.D + 0x1);
-            carry = true;
-        }
-        else
-            registers.A += registers.D;
+// SUB/SBC A, r/n
+template<uint8_t Op, typename Timing>
+void CPU::op_Subtract(uint16_t arg) {
+    uint8_t carry = (Op & 0x08) && carry_flag() ? 1 : 0;
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+    registers.A = alu_sub(registers.A, alu_operand<Op, Timing>(arg), carry);
+}
 
-        registers.F &= ~FLAG_ADSB;
+template<uint8_t Op, typename Timing>
+void CPU::op_And(uint16_t arg) {
+    registers.A = alu_and(registers.A, alu_operand<Op, Timing>(arg));
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+template<uint8_t Op, typename Timing>
+void CPU::op_Or(uint16_t arg) {
+    registers.A = alu_or(registers.A, alu_operand<Op, Timing>(arg));
+}
 
-        if (carry) {
-            if ((oldA & 0xF) + ((registers.D + 0x1) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if ((oldA & 0xF) + ((registers.D) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x8B):
-        oldA = registers.A;
-        carry = false;
+template<uint8_t Op, typename Timing>
+void CPU::op_Xor(uint16_t arg) {
+    registers.A = alu_xor(registers.A, alu_operand<Op, Timing>(arg));
+}
 
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A += (registers.E + 0x1);
-            carry = true;
-        }
-        else
-            registers.A += registers.E;
+// Subtract without storing the result
+template<uint8_t Op, typename Timing>
+void CPU::op_Compare(uint16_t arg) {
+    alu_sub(registers.A, alu_operand<Op, Timing>(arg), 0);
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+template<uint8_t Op, typename Timing>
+void CPU::op_Increment(uint16_t arg) {
+    if constexpr ((Op & 0x7) == 3) {
+        // INC rr: no flags
+        constexpr uint8_t p = Op >> 4;
 
-        registers.F &= ~FLAG_ADSB;
+        write_rp<p>(read_rp<p>() + 1);
+    }
+    else {
+        // INC r: carry is left alone
+        constexpr uint8_t y = (Op >> 3) & 0x7;
+        uint8_t res = read_r8<y, Timing>() + 1;
+
+        write_r8<y, Timing>(res);
+        lazy.carry = carry_flag();
+        lazy.op = FLAGS_INC;
+        lazy.res = res;
+    }
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+template<uint8_t Op, typename Timing>
+void CPU::op_Decrement(uint16_t arg) {
+    if constexpr ((Op & 0x7) == 3) {
+        // DEC rr: no flags
+        constexpr uint8_t p = Op >> 4;
 
-        if (carry) {
-            if ((oldA & 0xF) + ((registers.E + 0x1) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if ((oldA & 0xF) + ((registers.E) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x8C):
-        oldA = registers.A;
-        carry = false;
+        write_rp<p>(read_rp<p>() - 1);
+    }
+    else {
+        // DEC r: carry is left alone
+        constexpr uint8_t y = (Op >> 3) & 0x7;
+        uint8_t res = read_r8<y, Timing>() - 1;
+
+        write_r8<y, Timing>(res);
+        lazy.carry = carry_flag();
+        lazy.op = FLAGS_DEC;
+        lazy.res = res;
+    }
+}
 
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A += (registers.H + 0x1);
-            carry = true;
-        }
-        else
-            registers.A += registers.H;
+// RLCA RRCA RLA RRA: accumulator-only rotates always clear Z
+template<uint8_t Op>
+void CPU::op_Rotate(uint16_t arg) {
+    uint8_t a = registers.A;
+    uint8_t carry = carry_flag() ? 1 : 0;
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+    if constexpr (Op == 0x07) {
+        registers.A = (uint8_t)((a << 1) | (a >> 7));
+        carry = a >> 7;
+    }
+    else if constexpr (Op == 0x0F) {
+        registers.A = (uint8_t)((a >> 1) | (a << 7));
+        carry = a & 0x1;
+    }
+    else if constexpr (Op == 0x17) {
+        registers.A = (uint8_t)((a << 1) | carry);
+        carry = a >> 7;
+    }
+    else {
+        registers.A = (uint8_t)((a >> 1) | (carry << 7));
+        carry = a & 0x1;
+    }
 
-        registers.F &= ~FLAG_ADSB;
+    set_F(carry ? FLAG_CARY : 0x0);
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+// DAA: adjust A back to BCD after an add or subtract
+void CPU::op_Decimal(uint16_t arg) {
+    uint16_t res = alu_tables.daa[(get_F() >> 4) & 0x7][registers.A];
 
-        if (carry) {
-            if ((oldA & 0xF) + ((registers.H + 0x1) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if ((oldA & 0xF) + ((registers.H) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x8D):
-        oldA = registers.A;
-        carry = false;
+    registers.A = (uint8_t)(res >> 8);
+    set_F((uint8_t)res);
+}
 
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A += (registers.L + 0x1);
-            carry = true;
-        }
-        else
-            registers.A += registers.L;
+void CPU::op_Complement(uint16_t arg) {
+    registers.A = ~registers.A;
+    set_F(get_F() | FLAG_ADSB | FLAG_HALF);
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+void CPU::op_CompCarry(uint16_t arg) {
+    set_F((get_F() ^ FLAG_CARY) & (FLAG_ZERO | FLAG_CARY));
+}
 
-        registers.F &= ~FLAG_ADSB;
+void CPU::op_Carry(uint16_t arg) {
+    set_F((get_F() & FLAG_ZERO) | FLAG_CARY);
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+void CPU::op_Nop(uint16_t arg) {
+    //Op? Nop.
+}
 
-        if (carry) {
-            if ((oldA & 0xF) + ((registers.L + 0x1) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if ((oldA & 0xF) + ((registers.L) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x8E):
-        oldA = registers.A;
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        carry = false;
-
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A += (get + 0x1);
-            carry = true;
-        }
-        else
-            registers.A += get;
+// Sleep until an enabled interrupt is requested; run_for() skips the
+// wait in one go with idle()
+void CPU::op_Halt(uint16_t arg) {
+    gbmemory.sync_events();
+    if (!gbmemory.pending_interrupts())
+        halted = true;
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+// Like HALT, but only a joypad press wakes it. Also resets DIV.
+void CPU::op_Stop(uint16_t arg) {
+    gbmemory.set_memory(0xFF04, 0x00);
+    halted = true;
+    stopped = true;
+}
 
-        registers.F &= ~FLAG_ADSB;
+void CPU::op_DInterrupt(uint16_t arg) {
+    ime = false;
+    ei_delay = false;
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+// Takes effect after the next instruction, see check_interrupts()
+void CPU::op_EInterrupt(uint16_t arg) {
+    if (!ime)
+        ei_delay = true;
+    irq_check = 0;
+}
 
-        if (carry) {
-            if ((oldA & 0xF) + ((get + 0x1) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
+// JR, JR cc, JP, JP cc, JP HL
+template<uint8_t Op>
+void CPU::op_Jump(uint16_t arg) {
+    if constexpr (Op == 0x18) {
+        registers.PC += (int8_t)arg;
+    }
+    else if constexpr (Op < 0x40) {
+        if (condition<((Op >> 3) & 0x3)>()) {
+            registers.PC += (int8_t)arg;
+            branch_taken = true;
         }
-        else {
-            if ((oldA & 0xF) + ((get)&0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
+    }
+    else if constexpr (Op == 0xC3) {
+        registers.PC = arg;
+    }
+    else if constexpr (Op == 0xE9) {
+        registers.PC = read_rp<2>();
+    }
+    else {
+        if (condition<((Op >> 3) & 0x3)>()) {
+            registers.PC = arg;
+            branch_taken = true;
         }
-        break;
-    case (0x8F):
-        oldA = registers.A;
-        carry = false;
+    }
+}
 
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A += (registers.A + 0x1);
-            carry = true;
+template<uint8_t Op, typename Timing>
+void CPU::op_Call(uint16_t arg) {
+    if constexpr (Op == 0xCD) {
+        internal_cycle<Timing>();
+        push_16bit<Timing>(registers.PC);
+        registers.PC = arg;
+    }
+    else {
+        if (condition<((Op >> 3) & 0x3)>()) {
+            internal_cycle<Timing>();
+            push_16bit<Timing>(registers.PC);
+            registers.PC = arg;
+            branch_taken = true;
         }
-        else
-            registers.A += registers.A;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
+    }
+}
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+// RST n: the target is encoded in the OP code
+template<uint8_t Op, typename Timing>
+void CPU::op_Restart(uint16_t arg) {
+    internal_cycle<Timing>();
+    push_16bit<Timing>(registers.PC);
+    registers.PC = Op & 0x38;
+}
 
-        if (carry) {
-            if ((oldA & 0xF) + ((oldA + 0x1) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if ((oldA & 0xF) + ((oldA)&0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
+template<uint8_t Op, typename Timing>
+void CPU::op_Return(uint16_t arg) {
+    if constexpr (Op == 0xC9) {
+        registers.PC = pop_16bit<Timing>();
+    }
+    else if constexpr (Op == 0xD9) {
+        registers.PC = pop_16bit<Timing>();
+        ime = true;
+        irq_check = 0;
+    }
+    else {
+        // The condition takes an M-cycle of its own
+        internal_cycle<Timing>();
+        if (condition<((Op >> 3) & 0x3)>()) {
+            registers.PC = pop_16bit<Timing>();
+            branch_taken = true;
         }
-        break;
-    case (0xC6):
-        oldA = registers.A;
-        registers.A += (uint8_t)arg;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+    }
+}
 
-        registers.F &= ~FLAG_ADSB;
+// CB-prefixed OP code is the argument. Its timing is nothing but
+// memory accesses, so with mcycleTiming they've added it all already.
+template<typename Timing>
+void CPU::op_CB(uint16_t arg) {
+    uint8_t cbop = (uint8_t)arg;
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+    (this->*(Timing::per_access ? mcycle_cb_opcodes : cb_opcodes)[cbop])();
 
-        if ((oldA & 0xF) + (((uint8_t)arg) & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0xCE):
-        oldA = registers.A;
-        carry = false;
+    uint8_t taken = op_info[0x100 | cbop].cycles;
 
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A += ((uint8_t)arg + 0x1);
-            carry = true;
-        }
-        else
-            registers.A += (uint8_t)arg;
+    if constexpr (!Timing::per_access)
+        cycles += taken;
+#ifdef GBEMU_PROFILE
+    profiler.record_cb(cbop, taken);
+#endif
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+void CPU::op_Unknown(uint16_t arg) {
+    std::cout << "Unknown OPcode: " << std::hex << (int)gbmemory.get_memory(registers.PC - 1) << std::dec << "\n";
+#ifdef GBEMU_TRACE
+    // Keep what led up to the first one
+    if (!trace_saved) {
+        trace_saved = true;
+        if (trace.save(TRACE_FILE))
+            std::cout << "Trace saved to " << TRACE_FILE << "\n";
+    }
+#endif
+}
 
-        registers.F &= ~FLAG_ADSB;
+///////////////////////////
+// Fused OP code functions //
+///////////////////////////
+
+// PC is already past the whole sequence and is wound back to the next
+// instruction to run when stopping early. Each instruction of it is
+// counted as it completes.
+template<bool CountBC>
+void CPU::fused_Copy(uint16_t arg) {
+    uint16_t start = registers.PC - (CountBC ? 4 : 3);
+
+    fused_hits[CountBC ? FUSED_COPY_BC : FUSED_COPY]++;
+
+    registers.A = gbmemory.get_memory(registers.HL++);
+    cycles += 8;
+    instructions++;
+    if (cycles >= deadline) {
+        registers.PC = start + 1;
+        return;
+    }
 
-        if (oldA > registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+    gbmemory.set_memory(registers.DE, registers.A);
+    cycles += 8;
+    instructions++;
+    if (cycles >= deadline || gbmemory.exit_blocks) {
+        registers.PC = start + 2;
+        return;
+    }
 
-        if (carry) {
-            if ((oldA & 0xF) + (((uint8_t)arg + 0x1) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
+    registers.DE++;
+    cycles += 8;
+    instructions++;
+    if constexpr (CountBC) {
+        if (cycles >= deadline) {
+            registers.PC = start + 3;
+            return;
         }
-        else {
-            if ((oldA & 0xF) + (((uint8_t)arg) & 0xF) & 0x10)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0xE8):
-        oldSP = registers.SP;
-
-        if ((registers.F & FLAG_CARY) > 0x0)
-            registers.SP = arg + 0x1;
-        else
-            registers.SP = arg;
-
-        registers.F &= ~FLAG_ZERO;
-        registers.F &= ~FLAG_ADSB;
-
-        if (oldSP > registers.SP)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
 
-        if ((uint8_t)registers.SP < (uint8_t)oldSP)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    default:
-        break;
+        registers.BC--;
+        cycles += 8;
+        instructions++;
     }
 }
 
-void CPU::op_Subtract(uint8_t opcode, uint16_t arg) {
-    uint8_t oldA, get;
-    bool carry;
-
-    switch (opcode) {
-    case (0x90):
-        oldA = registers.A;
-        registers.A -= registers.B;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((oldA & 0xF) - (registers.B & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x91):
-        oldA = registers.A;
-        registers.A -= registers.C;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((oldA & 0xF) - (registers.C & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x92):
-        oldA = registers.A;
-        registers.A -= registers.D;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((oldA & 0xF) - (registers.D & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x93):
-        oldA = registers.A;
-        registers.A -= registers.E;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((oldA & 0xF) - (registers.E & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x94):
-        oldA = registers.A;
-        registers.A -= registers.H;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((oldA & 0xF) - (registers.H & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x95):
-        oldA = registers.A;
-        registers.A -= registers.L;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+// arg: n | m << 8. Keeps polling until the value matches or time's up.
+void CPU::fused_Poll(uint16_t arg) {
+    uint16_t start = registers.PC - 6;
 
-        registers.F |= FLAG_ADSB;
+    fused_hits[FUSED_POLL]++;
 
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+    for (;;) {
+        // Once a pass fails, the value it read stays the same until then
+        uint64_t until = gbmemory.next_change(Scheduler::source(0xFF00 | (arg & 0xFF)) | Scheduler::SOURCE_IRQ);
 
-        if (((oldA & 0xF) - (registers.L & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x96):
-        oldA = registers.A;
-        registers.A -= gbmemory.get_memory(concat_regist(registers.L, registers.H));
+        registers.A = gbmemory.get_memory(0xFF00 | (arg & 0xFF));
+        cycles += 12;
+        instructions++;
+        if (cycles >= deadline) {
+            registers.PC = start + 2;
+            return;
+        }
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+        alu_sub(registers.A, arg >> 8, 0);
+        cycles += 8;
+        instructions++;
+        if (cycles >= deadline) {
+            registers.PC = start + 4;
+            return;
+        }
 
-        registers.F |= FLAG_ADSB;
+        if (lazy.res == 0x0) {
+            cycles += 8;
+            instructions++;
+            return;
+        }
 
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+        cycles += 12;
 
-        if (((oldA & 0xF) - (gbmemory.get_memory(concat_regist(registers.L, registers.H)) & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x97):
-        oldA = registers.A;
-        registers.A -= registers.A;
+        instructions++;
+        skip_passes(32, 3, until);
+        if (cycles >= deadline) {
+            registers.PC = start;
+            return;
+        }
+    }
+}
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+// arg: register field of the DEC. Counts it down to zero, or until
+// time's up.
+void CPU::fused_Delay(uint16_t arg) {
+    uint8_t* const regs[8] = {&registers.B, &registers.C, &registers.D, &registers.E, &registers.H, &registers.L, nullptr, &registers.A};
+    uint8_t* r = regs[arg];
+    uint16_t start = registers.PC - 3;
 
-        registers.F |= FLAG_ADSB;
+    fused_hits[FUSED_DELAY]++;
 
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+    lazy.carry = carry_flag();
+    lazy.op = FLAGS_DEC;
 
-        if (((oldA & 0xF) - (registers.A & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x98):
-        oldA = registers.A;
-        carry = false;
+    for (;;) {
+        lazy.res = --*r;
+        cycles += 4;
+        instructions++;
+        if (cycles >= deadline) {
+            registers.PC = start + 1;
+            return;
+        }
 
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A -= (registers.B - 0x1);
-            carry = true;
+        if (lazy.res == 0x0) {
+            cycles += 8;
+            instructions++;
+            return;
         }
-        else
-            registers.A -= registers.B;
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+        cycles += 12;
 
-        registers.F |= FLAG_ADSB;
+        instructions++;
+        if (cycles >= deadline) {
+            registers.PC = start;
+            return;
+        }
+    }
+}
 
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+///////////////////////////
+// CB OP code functions  //
+///////////////////////////
+
+// RLC RRC RL RR SLA SRA SWAP SRL: N and H clear, Z from the result,
+// C from the bit shifted out (always clear for SWAP)
+template<uint8_t Op, typename Timing>
+void CPU::cb_Shift() {
+    constexpr uint8_t y = (Op >> 3) & 0x7;
+    uint8_t val = read_r8<Op & 0x7, Timing>();
+    uint8_t res;
+    uint8_t carry;
+
+    if constexpr (y == 0) {
+        res = (uint8_t)((val << 1) | (val >> 7));
+        carry = val >> 7;
+    }
+    else if constexpr (y == 1) {
+        res = (uint8_t)((val >> 1) | (val << 7));
+        carry = val & 0x1;
+    }
+    else if constexpr (y == 2) {
+        res = (uint8_t)((val << 1) | (carry_flag() ? 0x01 : 0x00));
+        carry = val >> 7;
+    }
+    else if constexpr (y == 3) {
+        res = (uint8_t)((val >> 1) | (carry_flag() ? 0x80 : 0x00));
+        carry = val & 0x1;
+    }
+    else if constexpr (y == 4) {
+        res = (uint8_t)(val << 1);
+        carry = val >> 7;
+    }
+    else if constexpr (y == 5) {
+        res = (uint8_t)((val >> 1) | (val & 0x80));
+        carry = val & 0x1;
+    }
+    else if constexpr (y == 6) {
+        res = (uint8_t)((val << 4) | (val >> 4));
+        carry = 0;
+    }
+    else {
+        res = val >> 1;
+        carry = val & 0x1;
+    }
 
-        if (carry) {
-            if (((oldA & 0xF) - ((registers.B - 0x1) & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if (((oldA & 0xF) - (registers.B & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x99):
-        oldA = registers.A;
-        carry = false;
+    write_r8<Op & 0x7, Timing>(res);
+    set_F((res == 0x0 ? FLAG_ZERO : 0x0) | (carry ? FLAG_CARY : 0x0));
+}
 
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A -= (registers.C - 0x1);
-            carry = true;
-        }
-        else
-            registers.A -= registers.C;
+// BIT: Z set if the bit is clear, N clear, H set, C kept
+template<uint8_t Op, typename Timing>
+void CPU::cb_Bit() {
+    constexpr uint8_t mask = 1 << ((Op >> 3) & 0x7);
 
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
+    set_F(((read_r8<Op & 0x7, Timing>() & mask) == 0x0 ? FLAG_ZERO : 0x0) | FLAG_HALF | (carry_flag() ? FLAG_CARY : 0x0));
+}
 
-        registers.F |= FLAG_ADSB;
+// RES and SET leave the flags alone
+template<uint8_t Op, typename Timing>
+void CPU::cb_Res() {
+    constexpr uint8_t mask = 1 << ((Op >> 3) & 0x7);
 
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
+    write_r8<Op & 0x7, Timing>(read_r8<Op & 0x7, Timing>() & ~mask);
+}
 
-        if (carry) {
-            if (((oldA & 0xF) - ((registers.C - 0x1) & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if (((oldA & 0xF) - (registers.C & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x9A):
-        oldA = registers.A;
-        carry = false;
-
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A -= (registers.D - 0x1);
-            carry = true;
-        }
-        else
-            registers.A -= registers.D;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (carry) {
-            if (((oldA & 0xF) - ((registers.D - 0x1) & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if (((oldA & 0xF) - (registers.D & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x9B):
-        oldA = registers.A;
-        carry = false;
-
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A -= (registers.E - 0x1);
-            carry = true;
-        }
-        else
-            registers.A -= registers.E;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (carry) {
-            if (((oldA & 0xF) - ((registers.E - 0x1) & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if (((oldA & 0xF) - (registers.E & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x9C):
-        oldA = registers.A;
-        carry = false;
-
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A -= (registers.H - 0x1);
-            carry = true;
-        }
-        else
-            registers.A -= registers.H;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (carry) {
-            if (((oldA & 0xF) - ((registers.H - 0x1) & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if (((oldA & 0xF) - (registers.H & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x9D):
-        oldA = registers.A;
-        carry = false;
-
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A -= (registers.L - 0x1);
-            carry = true;
-        }
-        else
-            registers.A -= registers.L;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (carry) {
-            if (((oldA & 0xF) - ((registers.L - 0x1) & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if (((oldA & 0xF) - (registers.L & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x9E):
-        oldA = registers.A;
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        carry = false;
-
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A -= (get - 0x1);
-            carry = true;
-        }
-        else
-            registers.A -= get;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (carry) {
-            if (((oldA & 0xF) - ((get - 0x1) & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if (((oldA & 0xF) - (get & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0x9F):
-        oldA = registers.A;
-        carry = false;
-
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A -= (registers.A - 0x1);
-            carry = true;
-        }
-        else
-            registers.A -= registers.A;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (carry) {
-            if (((oldA & 0xF) - ((registers.A - 0x1) & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if (((oldA & 0xF) - (registers.A & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    case (0xD6):
-        oldA = registers.A;
-        registers.A -= (uint8_t)arg;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((oldA & 0xF) - ((uint8_t)arg & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0xDE):
-        oldA = registers.A;
-        carry = false;
-
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            registers.A -= ((uint8_t)arg - 0x1);
-            carry = true;
-        }
-        else
-            registers.A -= (uint8_t)arg;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (oldA < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (carry) {
-            if (((oldA & 0xF) - (((uint8_t)arg - 0x1) & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        else {
-            if (((oldA & 0xF) - ((uint8_t)arg & 0xF) & 0x10) < 0)
-                registers.F |= FLAG_HALF;
-            else
-                registers.F &= ~FLAG_HALF;
-        }
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_And(uint8_t opcode, uint16_t arg) {
-    switch (opcode) {
-    case (0xA0):
-        registers.A &= registers.B;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xA1):
-        registers.A &= registers.C;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xA2):
-        registers.A &= registers.D;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xA3):
-        registers.A &= registers.E;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xA4):
-        registers.A &= registers.H;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xA5):
-        registers.A &= registers.L;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xA6):
-        registers.A &= gbmemory.get_memory(concat_regist(registers.L, registers.H));
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xA7):
-        registers.A &= registers.A;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xE6):
-        registers.A &= (uint8_t)arg;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Or(uint8_t opcode, uint16_t arg) {
-    switch (opcode) {
-    case (0xB0):
-        registers.A |= registers.B;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xB1):
-        registers.A |= registers.C;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xB2):
-        registers.A |= registers.D;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xB3):
-        registers.A |= registers.E;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xB4):
-        registers.A |= registers.H;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xB5):
-        registers.A |= registers.L;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xB6):
-        registers.A |= gbmemory.get_memory(concat_regist(registers.L, registers.H));
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xB7):
-        registers.A |= registers.A;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xF6):
-        registers.A |= (uint8_t)arg;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    }
-}
-
-void CPU::op_Xor(uint8_t opcode, uint16_t arg) {
-    switch (opcode) {
-    case (0xA8):
-        registers.A ^= registers.B;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xA9):
-        registers.A ^= registers.C;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xAA):
-        registers.A ^= registers.D;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xAB):
-        registers.A ^= registers.E;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xAC):
-        registers.A ^= registers.H;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xAD):
-        registers.A ^= registers.L;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xAE):
-        registers.A ^= gbmemory.get_memory(concat_regist(registers.L, registers.H));
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xAF):
-        registers.A ^= registers.A;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0xEE):
-        registers.A ^= (uint8_t)arg;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Compare(uint8_t opcode, uint16_t arg) {
-    uint8_t comp, get;
-
-    switch (opcode) {
-    case (0xB8):
-        comp = registers.A - registers.B;
-
-        if (comp == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (comp < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((registers.A & 0xF) - (registers.B & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0xB9):
-        comp = registers.A - registers.C;
-
-        if (comp == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (comp < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((registers.A & 0xF) - (registers.C & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0xBA):
-        comp = registers.A - registers.D;
-
-        if (comp == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (comp < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((registers.A & 0xF) - (registers.D & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0xBB):
-        comp = registers.A - registers.E;
-
-        if (comp == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (comp < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((registers.A & 0xF) - (registers.E & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0xBC):
-        comp = registers.A - registers.H;
-
-        if (comp == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (comp < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((registers.A & 0xF) - (registers.H & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0xBD):
-        comp = registers.A - registers.L;
-
-        if (comp == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (comp < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((registers.A & 0xF) - (registers.L & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0xBE):
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        comp = registers.A - get;
-
-        if (comp == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (comp < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((registers.A & 0xF) - (get & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0xBF):
-        comp = registers.A - registers.A;
-
-        if (comp == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (comp < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((registers.A & 0xF) - (registers.A & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0xFE):
-        comp = registers.A - (uint8_t)arg;
-
-        if (comp == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (comp < registers.A)
-            registers.F |= FLAG_CARY;
-        else
-            registers.F &= ~FLAG_CARY;
-
-        if (((registers.A & 0xF) - ((uint8_t)arg & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Increment(uint8_t opcode, uint16_t arg) {
-    uint8_t old, neww;
-    uint16_t old16, neww16;
-
-    switch (opcode) {
-    case (0x03):
-        old16 = concat_regist(registers.B, registers.C);
-        neww16 = old16 + 1;
-        registers.B = (uint8_t)(neww >> 8);
-        registers.C = (uint8_t)neww;
-        break;
-    case (0x04):
-        old = registers.B;
-        registers.B++;
-
-        if (registers.B == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-
-        if ((old & 0xF) + (0x1 & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x0C):
-        old = registers.C;
-        registers.C++;
-
-        if (registers.C == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-
-        if ((old & 0xF) + (0x1 & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x13):
-        old16 = concat_regist(registers.D, registers.E);
-        neww16 = old16 + 1;
-        registers.D = (uint8_t)(neww >> 8);
-        registers.E = (uint8_t)neww;
-        break;
-    case (0x14):
-        old = registers.D;
-        registers.D++;
-
-        if (registers.D == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-
-        if ((old & 0xF) + (0x1 & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x1C):
-        old = registers.E;
-        registers.E++;
-
-        if (registers.E == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-
-        if ((old & 0xF) + (0x1 & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x23):
-        old16 = concat_regist(registers.H, registers.L);
-        neww16 = old16 + 1;
-        registers.H = (uint8_t)(neww >> 8);
-        registers.L = (uint8_t)neww;
-        break;
-    case (0x24):
-        old = registers.H;
-        registers.H++;
-
-        if (registers.H == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-
-        if ((old & 0xF) + (0x1 & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x2C):
-        old = registers.L;
-        registers.L++;
-
-        if (registers.L == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-
-        if ((old & 0xF) + (0x1 & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x33):
-        inc_16bit(registers.SP);
-        break;
-    case (0x34):
-        old = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), old + 1);
-        neww = old + 1;
-
-        if (neww == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-
-        if ((old & 0xF) + (0x1 & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x3C):
-        old = registers.A;
-        registers.A++;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-
-        if ((old & 0xF) + (0x1 & 0xF) & 0x10)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Decrement(uint8_t opcode, uint16_t arg) {
-    uint8_t old, neww;
-    uint16_t old16, neww16;
-
-    switch (opcode) {
-    case (0x05):
-        old = registers.B;
-        registers.B--;
-
-        if (registers.B == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (((old & 0xF) - (0x1 & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x0B):
-        old16 = concat_regist(registers.B, registers.C);
-        neww16 = old16 - 1;
-        registers.B = (uint8_t)(neww >> 8);
-        registers.C = (uint8_t)neww;
-        break;
-    case (0x0D):
-        old = registers.C;
-        registers.C--;
-
-        if (registers.C == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (((old & 0xF) - (0x1 & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x15):
-        old = registers.D;
-        registers.D--;
-
-        if (registers.D == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (((old & 0xF) - (0x1 & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x1B):
-        old16 = concat_regist(registers.D, registers.E);
-        neww16 = old16 - 1;
-        registers.D = (uint8_t)(neww >> 8);
-        registers.E = (uint8_t)neww;
-        break;
-    case (0x1D):
-        old = registers.E;
-        registers.E--;
-
-        if (registers.E == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (((old & 0xF) - (0x1 & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x25):
-        old = registers.H;
-        registers.H--;
-
-        if (registers.H == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (((old & 0xF) - (0x1 & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x2B):
-        old16 = concat_regist(registers.H, registers.L);
-        neww16 = old16 - 1;
-        registers.H = (uint8_t)(neww >> 8);
-        registers.L = (uint8_t)neww;
-        break;
-    case (0x2D):
-        old = registers.L;
-        registers.L--;
-
-        if (registers.L == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (((old & 0xF) - (0x1 & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x35):
-        old = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), old + 1);
-        neww = old - 1;
-
-        if (neww == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F |= FLAG_ADSB;
-
-        if (((old & 0xF) - (0x1 & 0xF) & 0x10) < 0)
-            registers.F |= FLAG_HALF;
-        else
-            registers.F &= ~FLAG_HALF;
-        break;
-    case (0x3B):
-        dec_16bit(registers.SP);
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Swap(uint8_t opcode, uint16_t arg) {
-    uint8_t old, neww;
-
-    switch (opcode) {
-    case (0x30):
-        registers.B = (registers.B << 4) | (registers.B >> 4);
-
-        if (registers.B == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0x31):
-        registers.C = (registers.C << 4) | (registers.C >> 4);
-
-        if (registers.C == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0x32):
-        registers.D = (registers.D << 4) | (registers.D >> 4);
-
-        if (registers.D == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0x33):
-        registers.E = (registers.E << 4) | (registers.E >> 4);
-
-        if (registers.E == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0x34):
-        registers.H = (registers.H << 4) | (registers.H >> 4);
-
-        if (registers.H == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0x35):
-        registers.L = (registers.L << 4) | (registers.L >> 4);
-
-        if (registers.L == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0x36):
-        old = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        neww = (old << 4) | (old >> 4);
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), neww);
-
-        if (neww == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    case (0x37):
-        registers.A = (registers.A << 4) | (registers.A >> 4);
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-        registers.F &= ~FLAG_CARY;
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Decimal(uint8_t opcode, uint16_t arg) {
-    uint8_t old = registers.A;
-    uint8_t nibup = (registers.A >> 4) * 10;
-    uint8_t nibdn = (registers.A << 4) >> 4;
-
-    registers.A = nibup + nibdn;
-
-    if (registers.A == 0x0)
-        registers.F |= FLAG_ZERO;
-    else
-        registers.F &= ~FLAG_ZERO;
-
-    registers.F &= ~FLAG_HALF;
-
-    if (old > registers.A)
-        registers.F |= FLAG_CARY;
-    else
-        registers.F &= ~FLAG_CARY;
-}
-
-void CPU::op_Complement(uint8_t opcode, uint16_t arg) {
-    registers.A = ~registers.A;
-    registers.F |= FLAG_ADSB;
-    registers.F |= FLAG_HALF;
-}
-
-void CPU::op_CompCarry(uint8_t opcode, uint16_t arg) {
-    if ((registers.F & FLAG_CARY) == 0x0)
-        registers.F |= FLAG_CARY;
-    else
-        registers.F &= ~FLAG_CARY;
-
-    registers.F &= ~FLAG_ADSB;
-    registers.F &= ~FLAG_HALF;
-}
-
-void CPU::op_Carry(uint8_t opcode, uint16_t arg) {
-    registers.F |= FLAG_CARY;
-    registers.F &= ~FLAG_ADSB;
-    registers.F &= ~FLAG_HALF;
-}
-
-void CPU::op_Nop(uint8_t opcode, uint16_t arg) {
-    //Op? Nop.
-}
-
-void CPU::op_Halt(uint8_t opcode, uint16_t arg) {
-    // TODO
-}
-
-void CPU::op_Stop(uint8_t opcode, uint16_t arg) {
-    // TODO
-}
-
-void CPU::op_DInterrupt(uint8_t opcode, uint16_t arg) {
-    // TODO
-}
-
-void CPU::op_EInterrupt(uint8_t opcode, uint16_t arg) {
-    // TODO
-}
-
-void CPU::op_Rotate(uint8_t opcode, uint16_t arg) {
-    uint8_t get, neww, set;
-
-    switch (opcode) {
-    case (0x00):
-        if ((registers.B >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.B = (registers.B << 1) | (registers.B >> 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.B == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x01):
-        if ((registers.C >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.C = (registers.C << 1) | (registers.C >> 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.C == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x02):
-        if ((registers.D >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.D = (registers.D << 1) | (registers.D >> 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.D == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x03):
-        if ((registers.E >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.E = (registers.E << 1) | (registers.E >> 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.E == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x04):
-        if ((registers.H >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.H = (registers.H << 1) | (registers.H >> 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.H == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x05):
-        if ((registers.L >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.L = (registers.L << 1) | (registers.L >> 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.L == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x06):
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        if ((get >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        neww = (get << 1) | (get >> 7);
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), neww);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (neww == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x07):
-        if ((registers.A >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.A = (registers.A << 1) | (registers.A >> 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x08):
-        if ((registers.B << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.B = (registers.B >> 1) | (registers.B << 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.B == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x09):
-        if ((registers.C << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.C = (registers.C >> 1) | (registers.C << 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.C == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x0A):
-        if ((registers.D << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.D = (registers.D >> 1) | (registers.D << 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.D == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x0B):
-        if ((registers.E << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.E = (registers.E >> 1) | (registers.E << 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.E == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x0C):
-        if ((registers.H << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.H = (registers.H >> 1) | (registers.H << 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.H == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x0D):
-        if ((registers.L << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.L = (registers.L >> 1) | (registers.L << 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.L == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x0E):
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        if ((get << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        neww = (get >> 1) | (get << 7);
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), neww);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (neww == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x0F):
-        if ((registers.A << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        registers.A = (registers.A >> 1) | (registers.A << 7);
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x10):
-        if ((registers.B >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.B = (registers.B << 1) | (registers.B >> 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.B == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x11):
-        if ((registers.C >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.C = (registers.C << 1) | (registers.C >> 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.C == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x12):
-        if ((registers.D >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.D = (registers.D << 1) | (registers.D >> 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.D == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x13):
-        if ((registers.E >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.E = (registers.E << 1) | (registers.E >> 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.E == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x14):
-        if ((registers.H >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.H = (registers.H << 1) | (registers.H >> 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.H == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x15):
-        if ((registers.L >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.L = (registers.L << 1) | (registers.L >> 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.L == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x16):
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        if ((get >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        set = (get << 1) | (get >> 7);
-        if (registers.F & FLAG_CARY)
-            gbmemory.set_memory(concat_regist(registers.L, registers.H), set);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if ((set == 0x0 && registers.F & FLAG_CARY) || (get == 0x0 && ~(registers.F & FLAG_CARY)))
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x17):
-        if ((registers.A >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.A = (registers.A << 1) | (registers.A >> 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x18):
-        if ((registers.B << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.B = (registers.B >> 1) | (registers.B << 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.B == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x19):
-        if ((registers.C << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.C = (registers.C >> 1) | (registers.C << 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.C == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x1A):
-        if ((registers.D << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.D = (registers.D >> 1) | (registers.D << 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.D == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x1B):
-        if ((registers.E << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.E = (registers.E >> 1) | (registers.E << 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.E == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x1C):
-        if ((registers.B << 7) == 0x0)
-            registers.H &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.H = (registers.H >> 1) | (registers.H << 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.H == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x1D):
-        if ((registers.L << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.L = (registers.L >> 1) | (registers.L << 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.L == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x1E):
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        if ((get << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        set = (get >> 1) | (get << 7);
-        if (registers.F & FLAG_CARY)
-            gbmemory.set_memory(concat_regist(registers.L, registers.H), set);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if ((set == 0x0 && registers.F & FLAG_CARY) || (get == 0x0 && ~(registers.F & FLAG_CARY)))
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x1F):
-        if ((registers.A << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.A = (registers.A >> 1) | (registers.A << 7);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Shift(uint8_t opcode, uint16_t arg) {
-    uint8_t get, set;
-    bool msb;
-
-    switch (opcode) {
-    case (0x20):
-        if ((registers.B >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.B = registers.B << 1;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.B == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x21):
-        if ((registers.C >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.C = registers.C << 1;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.C == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x22):
-        if ((registers.D >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.D = registers.D << 1;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.D == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x23):
-        if ((registers.E >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.E = registers.E << 1;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.E == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x24):
-        if ((registers.H >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.H = registers.H << 1;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.H == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x25):
-        if ((registers.L >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.L = registers.L << 1;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.L == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x26):
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        if ((get >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        set = get << 1;
-        if (registers.F & FLAG_CARY)
-            gbmemory.set_memory(concat_regist(registers.L, registers.H), set);
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if ((set == 0x0 && registers.F & FLAG_CARY) || (get == 0x0 && ~(registers.F & FLAG_CARY)))
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x27):
-        if ((registers.A >> 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.A = registers.A << 1;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x28):
-        if ((registers.B << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if ((registers.B >> 7) == 0x0) {
-            if (registers.F & FLAG_CARY)
-                registers.B = (registers.B >> 1) | 0b00000000;
-        }
-        else {
-            if (registers.F & FLAG_CARY)
-                registers.B = (registers.B >> 1) | 0b10000000;
-        }
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.B == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x29):
-        if ((registers.C << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if ((registers.C >> 7) == 0x0) {
-            if (registers.F & FLAG_CARY)
-                registers.C = (registers.C >> 1) | 0b00000000;
-        }
-        else {
-            if (registers.F & FLAG_CARY)
-                registers.C = (registers.C >> 1) | 0b10000000;
-        }
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.C == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x2A):
-        if ((registers.D << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if ((registers.D >> 7) == 0x0) {
-            if (registers.F & FLAG_CARY)
-                registers.D = (registers.D >> 1) | 0b00000000;
-        }
-        else {
-            if (registers.F & FLAG_CARY)
-                registers.D = (registers.D >> 1) | 0b10000000;
-        }
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.D == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x2B):
-        if ((registers.E << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if ((registers.E >> 7) == 0x0) {
-            if (registers.F & FLAG_CARY)
-                registers.E = (registers.E >> 1) | 0b00000000;
-        }
-        else {
-            if (registers.F & FLAG_CARY)
-                registers.E = (registers.E >> 1) | 0b10000000;
-        }
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.E == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x2C):
-        if ((registers.H << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if ((registers.H >> 7) == 0x0) {
-            if (registers.F & FLAG_CARY)
-                registers.H = (registers.H >> 1) | 0b00000000;
-        }
-        else {
-            if (registers.F & FLAG_CARY)
-                registers.H = (registers.H >> 1) | 0b10000000;
-        }
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.H == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x2D):
-        if ((registers.L << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if ((registers.L >> 7) == 0x0) {
-            if (registers.F & FLAG_CARY)
-                registers.L = (registers.L >> 1) | 0b00000000;
-        }
-        else {
-            if (registers.F & FLAG_CARY)
-                registers.L = (registers.L >> 1) | 0b10000000;
-        }
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.L == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x2E):
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-
-        if ((get << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if ((get >> 7) == 0x0) {
-            if (registers.F & FLAG_CARY)
-                gbmemory.set_memory(concat_regist(registers.L, registers.H), (get >> 1) | 0b00000000);
-        }
-        else {
-            if (registers.F & FLAG_CARY)
-                gbmemory.set_memory(concat_regist(registers.L, registers.H), (get >> 1) | 0b10000000);
-        }
-
-        set = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (set == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x2F):
-        if ((registers.A << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if ((registers.A >> 7) == 0x0) {
-            if (registers.F & FLAG_CARY)
-                registers.A = (registers.A >> 1) | 0b00000000;
-        }
-        else {
-            if (registers.F & FLAG_CARY)
-                registers.A = (registers.A >> 1) | 0b10000000;
-        }
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x38):
-        if ((registers.B << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.B = (registers.B >> 1) | 0b00000000;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.B == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x39):
-        if ((registers.C << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.C = (registers.C >> 1) | 0b00000000;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.C == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x3A):
-        if ((registers.D << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.D = (registers.D >> 1) | 0b00000000;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.D == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x3B):
-        if ((registers.E << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.E = (registers.E >> 1) | 0b00000000;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.E == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x3C):
-        if ((registers.H << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.H = (registers.H >> 1) | 0b00000000;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.H == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x3D):
-        if ((registers.L << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.L = (registers.L >> 1) | 0b00000000;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.L == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x3E):
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-
-        if ((get << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            gbmemory.set_memory(concat_regist(registers.L, registers.H), (get >> 1) | 0b00000000);
-
-        set = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (set == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    case (0x3F):
-        if ((registers.A << 7) == 0x0)
-            registers.F &= ~FLAG_CARY;
-        else
-            registers.F |= FLAG_CARY;
-
-        if (registers.F & FLAG_CARY)
-            registers.A = (registers.A >> 1) | 0b00000000;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F &= ~FLAG_HALF;
-
-        if (registers.A == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Bit(uint8_t opcode, uint16_t arg) {
-    uint8_t test, get, set;
-
-    switch (opcode) {
-    case (0x40):
-        test = 0b00000001 << arg;
-
-        if ((registers.B & test) == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        break;
-    case (0x41):
-        test = 0b00000001 << arg;
-
-        if ((registers.C & test) == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        break;
-    case (0x42):
-        test = 0b00000001 << arg;
-
-        if ((registers.D & test) == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        break;
-    case (0x43):
-        test = 0b00000001 << arg;
-
-        if ((registers.E & test) == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        break;
-    case (0x44):
-        test = 0b00000001 << arg;
-
-        if ((registers.H & test) == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        break;
-    case (0x45):
-        test = 0b00000001 << arg;
-
-        if ((registers.L & test) == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        break;
-    case (0x46):
-        test = 0b00000001 << arg;
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-
-        if ((get & test) == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        break;
-    case (0x47):
-        test = 0b00000001 << arg;
-
-        if ((registers.A & test) == 0x0)
-            registers.F |= FLAG_ZERO;
-        else
-            registers.F &= ~FLAG_ZERO;
-
-        registers.F &= ~FLAG_ADSB;
-        registers.F |= FLAG_HALF;
-        break;
-    case (0x80):
-        registers.B &= ~(0b00000001 < arg);
-        break;
-    case (0x81):
-        registers.C &= ~(0b00000001 < arg);
-        break;
-    case (0x82):
-        registers.D &= ~(0b00000001 < arg);
-        break;
-    case (0x83):
-        registers.E &= ~(0b00000001 < arg);
-        break;
-    case (0x84):
-        registers.H &= ~(0b00000001 < arg);
-        break;
-    case (0x85):
-        registers.L &= ~(0b00000001 < arg);
-        break;
-    case (0x86):
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), get & ~(0b00000001 < arg));
-        break;
-    case (0x87):
-        registers.L &= ~(0b00000001 < arg);
-        break;
-    case (0xC0):
-        registers.B |= (0b00000001 < arg);
-        break;
-    case (0xC1):
-        registers.C |= (0b00000001 < arg);
-        break;
-    case (0xC2):
-        registers.D |= (0b00000001 < arg);
-        break;
-    case (0xC3):
-        registers.E |= (0b00000001 < arg);
-        break;
-    case (0xC4):
-        registers.H |= (0b00000001 < arg);
-        break;
-    case (0xC5):
-        registers.L |= (0b00000001 < arg);
-        break;
-    case (0xC6):
-        get = gbmemory.get_memory(concat_regist(registers.L, registers.H));
-        gbmemory.set_memory(concat_regist(registers.L, registers.H), get | (0b00000001 < arg));
-        break;
-    case (0xC7):
-        registers.L |= (0b00000001 < arg);
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Jump(uint8_t opcode, uint16_t arg) {
-    switch (opcode) {
-    case (0x18):
-        registers.PC += (uint8_t)arg;
-        break;
-    case (0x20):
-        if ((registers.F & FLAG_ZERO) == 0x0)
-            registers.PC += (uint8_t)arg;
-        break;
-    case (0x28):
-        if ((registers.F & FLAG_ZERO) > 0x0)
-            registers.PC += (uint8_t)arg;
-        break;
-    case (0x30):
-        if ((registers.F & FLAG_CARY) == 0x0)
-            registers.PC += (uint8_t)arg;
-        break;
-    case (0x38):
-        if ((registers.F & FLAG_ZERO) > 0x0)
-            registers.PC += (uint8_t)arg;
-        break;
-    case (0xC2):
-        if ((registers.F & FLAG_ZERO) == 0x0)
-            registers.PC = arg;
-        break;
-    case (0xC3):
-        registers.PC = arg;
-        break;
-    case (0xCA):
-        if ((registers.F & FLAG_ZERO) > 0)
-            registers.PC = arg;
-        break;
-    case (0xD2):
-        if ((registers.F & FLAG_CARY) == 0x0)
-            registers.PC = arg;
-        break;
-    case (0xDA):
-        if ((registers.F & FLAG_CARY) > 0x0)
-            registers.PC = arg;
-        break;
-    case (0xE9):
-        registers.PC = concat_regist(registers.H, registers.L);
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Call(uint8_t opcode, uint16_t arg) {
-    switch (opcode) {
-    case (0xC4):
-        if ((registers.F & FLAG_ADSB) == 0x0) {
-            dec_16bit(registers.SP);
-            gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-            dec_16bit(registers.SP);
-            gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-            registers.PC = arg;
-        }
-        break;
-    case (0xCC):
-        if ((registers.F & FLAG_ADSB) > 0x0) {
-            dec_16bit(registers.SP);
-            gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-            dec_16bit(registers.SP);
-            gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-            registers.PC = arg;
-        }
-        break;
-    case (0xCD):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-        registers.PC = arg;
-        break;
-    case (0xD4):
-        if ((registers.F & FLAG_CARY) == 0x0) {
-            dec_16bit(registers.SP);
-            gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-            dec_16bit(registers.SP);
-            gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-            registers.PC = arg;
-        }
-        break;
-    case (0xDC):
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            dec_16bit(registers.SP);
-            gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-            dec_16bit(registers.SP);
-            gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-            registers.PC = arg;
-        }
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Restart(uint8_t opcode, uint16_t arg) {
-    switch (opcode) {
-    case (0xC7):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-        registers.PC = 0x0000;
-        break;
-    case (0xCF):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-        registers.PC = 0x0008;
-        break;
-    case (0xD7):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-        registers.PC = 0x0010;
-        break;
-    case (0xDF):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-        registers.PC = 0x0018;
-        break;
-    case (0xE7):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-        registers.PC = 0x0020;
-        break;
-    case (0xEF):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-        registers.PC = 0x0028;
-        break;
-    case (0xF7):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-        registers.PC = 0x0030;
-        break;
-    case (0xFF):
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)(registers.PC >> 8));
-        dec_16bit(registers.SP);
-        gbmemory.set_memory(swap_endian(registers.SP), (uint8_t)registers.PC);
-        registers.PC = 0x0038;
-        break;
-    default:
-        break;
-    }
-}
-
-void CPU::op_Return(uint8_t opcode, uint16_t arg) {
-    uint8_t least, most;
-
-    switch (opcode) {
-    case (0xC0):
-        if ((registers.F & FLAG_ZERO) == 0x0) {
-            least = gbmemory.get_memory(registers.SP);
-            inc_16bit(registers.SP);
-            most = gbmemory.get_memory(registers.SP);
-            dec_16bit(registers.SP);
-            registers.PC = (most << 8) | least;
-        }
-        break;
-    case (0xC8):
-        if ((registers.F & FLAG_ZERO) > 0x0) {
-            least = gbmemory.get_memory(registers.SP);
-            inc_16bit(registers.SP);
-            most = gbmemory.get_memory(registers.SP);
-            dec_16bit(registers.SP);
-            registers.PC = (most << 8) | least;
-        }
-        break;
-    case (0xC9):
-        least = gbmemory.get_memory(registers.SP);
-        inc_16bit(registers.SP);
-        most = gbmemory.get_memory(registers.SP);
-        dec_16bit(registers.SP);
-        registers.PC = (most << 8) | least;
-        break;
-    case (0xD0):
-        if ((registers.F & FLAG_CARY) == 0x0) {
-            least = gbmemory.get_memory(registers.SP);
-            inc_16bit(registers.SP);
-            most = gbmemory.get_memory(registers.SP);
-            dec_16bit(registers.SP);
-            registers.PC = (most << 8) | least;
-        }
-        break;
-    case (0xD8):
-        if ((registers.F & FLAG_CARY) > 0x0) {
-            least = gbmemory.get_memory(registers.SP);
-            inc_16bit(registers.SP);
-            most = gbmemory.get_memory(registers.SP);
-            dec_16bit(registers.SP);
-            registers.PC = (most << 8) | least;
-        }
-        break;
-    case (0xD9):
-        least = gbmemory.get_memory(registers.SP);
-        inc_16bit(registers.SP);
-        most = gbmemory.get_memory(registers.SP);
-        dec_16bit(registers.SP);
-        registers.PC = (most << 8) | least;
-        // TODO: enable interrupts
-        break;
-    }
-}
-
-void CPU::op_CB(uint8_t opcode, uint16_t arg) {
-    (this->*CBops[opcode])(opcode, arg);
-}
+template<uint8_t Op, typename Timing>
+void CPU::cb_Set() {
+    constexpr uint8_t mask = 1 << ((Op >> 3) & 0x7);
 
-void CPU::op_Unknown(uint8_t opcode, uint16_t arg) {
-    std::cout << "Unknown OPcode: " << opcode << "\n";
+    write_r8<Op & 0x7, Timing>(read_r8<Op & 0x7, Timing>() | mask);
 }
\ No newline at end of file
@@ -2,12 +2,43 @@
 #define CPU_H
 
 // C++ libraries
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 
 // GBemu sources
+#include "alu.h"
+#include "blockcache.h"
+#include "jit.h"
 #include "memory.h"
+#include "opinfo.h"
+#ifdef GBEMU_PROFILE
+#include "profiler.h"
+#endif
+#ifdef GBEMU_TRACE
+#include "trace.h"
+#endif
+
+// Define GBEMU_THREADED_DISPATCH to build run_for() as threaded code:
+// every handler ends in its own indirect jump to the next one
+// (labels as values, GCC/Clang only). Without it, run_for() loops
+// over step() and the portable CPU::opcodes table.
+#if defined(GBEMU_THREADED_DISPATCH) && !defined(__GNUC__)
+#error "GBEMU_THREADED_DISPATCH needs GCC or Clang labels as values"
+#endif
+
+// Define GBEMU_PROFILE to count executions and T-cycles per OP code and
+// per address in CPU::profiler. Without it none of that is compiled in.
+//
+// Define GBEMU_TRACE to keep the last few million instructions in
+// CPU::trace, saved to TRACE_FILE when an unknown OP code is hit.
+//
+// Both have to see every instruction, so builds with either leave out
+// fusion and the JIT.
+#if defined(GBEMU_PROFILE) || defined(GBEMU_TRACE)
+#define GBEMU_EVERY_OP
+#endif
 
 class CPU {
     public:
@@ -16,61 +47,253 @@ class CPU {
     const uint8_t FLAG_HALF = 0b00100000;
     const uint8_t FLAG_CARY = 0b00010000;
 
+    // Register pairs overlay their 8-bit halves in host byte order, so
+    // AF/BC/DE/HL are read and written with a single 16-bit access
     struct registerMap {
-        uint8_t A;   // Accumulator, general
-        uint8_t B;   // Counter, general, BC byte counter
-        uint8_t C;   // Counter, ports, general, BC byte counter
-        uint8_t D;   // General, destination address
-        uint8_t E;   // General, destination address
-        uint8_t F;   // Flags - Zero | Add/Sub | Half | Carry | 0000
-        uint8_t H;   // General, HL 16-bit accumulator
-        uint8_t L;   // General, HL 16-bit accumulator
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define REGISTER_PAIR(pair, most, least) \
+    union {                              \
+        uint16_t pair;                   \
+        struct {                         \
+            uint8_t most;                \
+            uint8_t least;               \
+        };                               \
+    }
+#else
+#define REGISTER_PAIR(pair, most, least) \
+    union {                              \
+        uint16_t pair;                   \
+        struct {                         \
+            uint8_t least;               \
+            uint8_t most;                \
+        };                               \
+    }
+#endif
+        REGISTER_PAIR(AF, A, F); // Accumulator | Flags - Zero | Add/Sub | Half | Carry | 0000
+        REGISTER_PAIR(BC, B, C); // Counter, general, BC byte counter
+        REGISTER_PAIR(DE, D, E); // General, destination address
+        REGISTER_PAIR(HL, H, L); // General, HL 16-bit accumulator
+#undef REGISTER_PAIR
         uint16_t SP; // Stack pointer
         uint16_t PC; // Program counter
     } registers;
 
-    void (CPU::*opcodes[0x100])(uint8_t, uint16_t);
-    void (CPU::*CBops[0x100])(uint8_t, uint16_t);
+    // Flags are evaluated lazily: ALU handlers record what they did in
+    // `lazy` and F is only worked out when something actually reads it
+    enum flagOp : uint8_t {
+        FLAGS_NONE, // registers.F is current
+        FLAGS_ADD,  // a + b + carry
+        FLAGS_SUB,  // a - b - carry
+        FLAGS_AND,  // Z from res, H set
+        FLAGS_OR,   // Z from res (OR and XOR)
+        FLAGS_INC,  // Z/H from res, C kept in carry
+        FLAGS_DEC   // Z/H from res, N set, C kept in carry
+    };
+
+    struct lazyFlags {
+        uint8_t op;    // flagOp of the last flag-setting ALU operation
+        uint8_t a;     // First operand
+        uint8_t b;     // Second operand
+        uint8_t carry; // Carry in, or the carry to keep for INC/DEC
+        uint8_t res;   // 8-bit result
+    } lazy;
+
+    // Timing policies: when memory accesses see the clock within an
+    // instruction. Handlers are built once per policy from the same
+    // definitions, so instruction-granular code carries none of the
+    // per-access bookkeeping.
+    struct instructionTiming {
+        static constexpr bool per_access = false; // Cycles added once the instruction is done
+    };
+    struct mcycleTiming {
+        static constexpr bool per_access = true; // Each access at the end of its own M-cycle
+    };
+
+    // Handler for one OP code, taking its immediate operand (if any)
+    using handler = void (CPU::*)(uint16_t);
+    // The same as a plain function, for calling from JIT code
+    using thunk = void (*)(CPU&, uint16_t);
+
+    static const std::array<handler, 0x100> opcodes;
+    static const std::array<handler, 0x100> mcycle_opcodes;
+    static const std::array<thunk, 0x100> thunks;
+
+    // Instruction sequences BlockCache decodes as a single handler
+    enum fusedOp : uint8_t {
+        FUSED_COPY,    // LD A,(HL+); LD (DE),A; INC DE
+        FUSED_COPY_BC, // LD A,(HL+); LD (DE),A; INC DE; DEC BC
+        FUSED_POLL,    // LDH A,(n); CP m; JR NZ,-6
+        FUSED_DELAY,   // DEC r; JR NZ,-3
+        FUSED_COUNT
+    };
+
+    static const std::array<handler, FUSED_COUNT> fused_handlers;
+    static const std::array<thunk, FUSED_COUNT> fused_thunks;
+    static const char* const fused_names[FUSED_COUNT];
+
+    // Handler for one CB-prefixed OP code, everything decoded already
+    using cb_handler = void (CPU::*)();
+
+    static const std::array<cb_handler, 0x100> cb_opcodes;
+    static const std::array<cb_handler, 0x100> mcycle_cb_opcodes;
+
+    // How run_for() executes code
+    enum coreMode : uint8_t {
+        CORE_INTERPRETER, // step() loop, or threaded code if built with it
+        CORE_BLOCKS,      // Pre-decoded blocks from `blocks`
+        CORE_JIT,         // Blocks, compiled to native code once hot
+        CORE_MCYCLE,      // step() loop with every memory access at its own M-cycle
+        CORE_COUNT
+    };
+
+    static const char* const core_names[CORE_COUNT];
+
     Memory gbmemory;
+    BlockCache blocks;
+    Jit jit;
+    uint8_t core;       // coreMode used by run_for()
+    uint64_t cycles;    // T-cycles executed since power-on
+    uint64_t instructions; // Instructions executed since power-on, skipped idle loop passes included
+    uint64_t deadline;  // Where run_for() next stops to look around: its target, or irq_check
+    bool branch_taken;  // Set by a conditional handler that took its branch
+    bool halted;        // HALT/STOP, waiting for an interrupt request
+    bool stopped;       // STOP, only the joypad wakes it
+    bool breakpoint;    // LD B,B has run, Mooneye-style tests' "done"; left for the caller to clear
+    bool ime;           // Interrupt master enable
+    bool ei_delay;      // EI ran, IME goes on after the next instruction
+    uint64_t irq_check; // Cycle to next look for an interrupt to service
+    uint64_t fused_hits[FUSED_COUNT]; // Times each fused handler has run
+    uint64_t idle_skipped;            // T-cycles jumped over in idle loops
+#ifdef GBEMU_PROFILE
+    Profiler profiler;
+#endif
+#ifdef GBEMU_TRACE
+    static constexpr const char* TRACE_FILE = "gbemu.trace";
+    Trace trace;
+    bool trace_saved; // Already saved for an unknown OP code
+#endif
 
     CPU();
     CPU(Memory& mem);
-    uint16_t swap_endian(uint16_t bytes);
-    uint16_t concat_regist(uint8_t most, uint8_t least);
-    void dec_16bit(uint8_t& most, uint8_t& least);
-    void dec_16bit(uint16_t& reg);
-    void inc_16bit(uint8_t& most, uint8_t& least);
-    void inc_16bit(uint16_t& reg);
-    void op_Load(uint8_t opcode, uint16_t arg);
-    void op_Push(uint8_t opcode, uint16_t arg);
-    void op_Pop(uint8_t opcode, uint16_t arg);
-    void op_Add(uint8_t opcode, uint16_t arg);
-    void op_Subtract(uint8_t opcode, uint16_t arg);
-    void op_And(uint8_t opcode, uint16_t arg);
-    void op_Or(uint8_t opcode, uint16_t arg);
-    void op_Xor(uint8_t opcode, uint16_t arg);
-    void op_Compare(uint8_t opcode, uint16_t arg);
-    void op_Increment(uint8_t opcode, uint16_t arg);
-    void op_Decrement(uint8_t opcode, uint16_t arg);
-    void op_Swap(uint8_t opcode, uint16_t arg);
-    void op_Decimal(uint8_t opcode, uint16_t arg);
-    void op_Complement(uint8_t opcode, uint16_t arg);
-    void op_CompCarry(uint8_t opcode, uint16_t arg);
-    void op_Carry(uint8_t opcode, uint16_t arg);
-    void op_Nop(uint8_t opcode, uint16_t arg);
-    void op_Halt(uint8_t opcode, uint16_t arg);
-    void op_Stop(uint8_t opcode, uint16_t arg);
-    void op_DInterrupt(uint8_t opcode, uint16_t arg);
-    void op_EInterrupt(uint8_t opcode, uint16_t arg);
-    void op_Rotate(uint8_t opcode, uint16_t arg);
-    void op_Shift(uint8_t opcode, uint16_t arg);
-    void op_Bit(uint8_t opcode, uint16_t arg);
-    void op_Jump(uint8_t opcode, uint16_t arg);
-    void op_Call(uint8_t opcode, uint16_t arg);
-    void op_Restart(uint8_t opcode, uint16_t arg);
-    void op_Return(uint8_t opcode, uint16_t arg);
-    void op_CB(uint8_t opcode, uint16_t arg);
-    void op_Unknown(uint8_t opcode, uint16_t arg);
+    void power_on();
+    template<typename Timing = instructionTiming>
+    unsigned step();
+    uint64_t run_for(uint64_t budget);
+    void run_blocks(uint64_t target);
+    void run_block(const BlockCache::block& b, uint64_t target);
+    void run_jit(uint64_t target);
+    void idle(uint64_t target);
+    template<typename Timing = instructionTiming>
+    void check_interrupts();
+#ifdef GBEMU_TRACE
+    void trace_op(uint16_t pc, uint8_t opcode, uint16_t arg);
+#endif
+    void idle_loop(BlockCache::block& b, uint64_t target);
+    void skip_passes(uint32_t length, uint32_t ops, uint64_t until);
+#ifdef GBEMU_THREADED_DISPATCH
+    void run_threaded(uint64_t target);
+#endif
+    template<uint8_t Op>
+    void execute();
+    template<typename Timing>
+    uint8_t read_memory(uint16_t addr);
+    template<typename Timing>
+    void write_memory(uint16_t addr, uint8_t val);
+    template<typename Timing>
+    void internal_cycle();
+    template<typename Timing>
+    void push_16bit(uint16_t val);
+    template<typename Timing>
+    uint16_t pop_16bit();
+    uint8_t get_F();
+    void set_F(uint8_t val);
+    bool zero_flag();
+    bool carry_flag();
+
+    // Operand decoding, R/P are the register fields of the OP code
+    template<uint8_t R, typename Timing>
+    uint8_t read_r8();
+    template<uint8_t R, typename Timing>
+    void write_r8(uint8_t val);
+    template<uint8_t P>
+    uint16_t read_rp();
+    template<uint8_t P>
+    void write_rp(uint16_t val);
+    template<uint8_t CC>
+    bool condition();
+    template<uint8_t Op, typename Timing>
+    uint8_t alu_operand(uint16_t arg);
+
+    // 8-bit ALU, results and flags shared by every OP code using them
+    uint8_t alu_add(uint8_t a, uint8_t b, uint8_t carry);
+    uint8_t alu_sub(uint8_t a, uint8_t b, uint8_t carry);
+    uint8_t alu_and(uint8_t a, uint8_t b);
+    uint8_t alu_or(uint8_t a, uint8_t b);
+    uint8_t alu_xor(uint8_t a, uint8_t b);
+
+    // Base OP codes, specialized per OP code (and timing policy, for those
+    // touching memory) at compile time
+    template<uint8_t Op, typename Timing>
+    void op_Load(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Push(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Pop(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Add(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Subtract(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_And(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Or(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Xor(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Compare(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Increment(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Decrement(uint16_t arg);
+    template<uint8_t Op>
+    void op_Rotate(uint16_t arg);
+    template<uint8_t Op>
+    void op_Jump(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Call(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Restart(uint16_t arg);
+    template<uint8_t Op, typename Timing>
+    void op_Return(uint16_t arg);
+    void op_Decimal(uint16_t arg);
+    void op_Complement(uint16_t arg);
+    void op_CompCarry(uint16_t arg);
+    void op_Carry(uint16_t arg);
+    void op_Nop(uint16_t arg);
+    void op_Halt(uint16_t arg);
+    void op_Stop(uint16_t arg);
+    void op_DInterrupt(uint16_t arg);
+    void op_EInterrupt(uint16_t arg);
+    template<typename Timing>
+    void op_CB(uint16_t arg);
+    void op_Unknown(uint16_t arg);
+
+    // Fused OP code sequences. Each adds its own cycles one instruction
+    // at a time and stops at `deadline` like run_block() would.
+    template<bool CountBC>
+    void fused_Copy(uint16_t arg);
+    void fused_Poll(uint16_t arg);
+    void fused_Delay(uint16_t arg);
+
+    // CB-prefixed OP codes, specialized per OP code like the base ones
+    template<uint8_t Op, typename Timing>
+    void cb_Shift();
+    template<uint8_t Op, typename Timing>
+    void cb_Bit();
+    template<uint8_t Op, typename Timing>
+    void cb_Res();
+    template<uint8_t Op, typename Timing>
+    void cb_Set();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,307 @@
+/*
+* difftest - run a ROM on the reference interpreter and on a fast core
+* side by side, and stop at the first point where they disagree
+*
+* Usage: difftest <ROM file> [options]
+*   -c <T-cycles>   How long to run for (default: 60 frames)
+*   -i <input log>  Joypad input to play back into both
+*   -k <core>       Fast core: interpreter, blocks, jit or mcycle (default: jit)
+*   -s <T-cycles>   How often to compare whole states (default: 1 frame)
+*
+* The reference is CORE_INTERPRETER with nothing fused. Every -s cycles
+* both are compared: registers, flags, IME/HALT, the cycle count and all
+* 64 KiB of memory. On a mismatch the stretch it showed up in is halved
+* until it can't be any more, replaying both from power-on each time,
+* and the reference's instructions over what's left are printed.
+* With -k mcycle, a timed register read or written mid-instruction
+* shows up as a difference: that core does it some cycles later.
+*
+* Input logs are text, one change per line, "#" starting a comment:
+*   <T-cycle> <buttons held, Memory::JOYPAD_* bits in hex>
+* e.g. "1200000 80" holds Start from cycle 1200000 on, "1300000 0"
+* lets go of it again.
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "opinfo.h"
+
+struct inputEvent {
+    uint64_t cycle;
+    uint8_t pressed;
+};
+
+// One of the two CPUs, and how far through the input log it is
+struct side {
+    std::unique_ptr<CPU> cpu;
+    std::size_t next_input;
+};
+
+// Reference instruction, for printing before a mismatch
+struct refStep {
+    uint64_t cycles;
+    uint16_t pc, af, bc, de, hl, sp;
+    uint8_t opcode;
+    uint16_t arg;
+};
+
+static const std::size_t HISTORY = 32; // refSteps printed at most
+
+static std::string rom_path;
+static std::vector<inputEvent> input;
+static uint8_t fast_core = CPU::CORE_JIT;
+
+static bool load_input(const char* path, std::vector<inputEvent>& out) {
+    std::ifstream file(path);
+    std::string line;
+
+    if (!file.is_open())
+        return false;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields(line);
+        unsigned long long cycle;
+        unsigned pressed;
+
+        if (fields >> cycle >> std::hex >> pressed)
+            out.push_back({cycle, (uint8_t)pressed});
+    }
+    return true;
+}
+
+static bool power_on(side& s, uint8_t core, bool fuse) {
+    s.cpu.reset(new CPU());
+    s.next_input = 0;
+    s.cpu->core = core;
+    s.cpu->blocks.fuse = fuse;
+    return s.cpu->gbmemory.load_rom(rom_path);
+}
+
+// Run to `until` in one go, bar stops to press buttons as the log says.
+// Every core stops at the first instruction boundary at or past its
+// target, so both sides always stop in the same places.
+static void run_to(side& s, uint64_t until) {
+    CPU& cpu = *s.cpu;
+
+    while (cpu.cycles < until) {
+        uint64_t target = until;
+
+        if (s.next_input < input.size() && input[s.next_input].cycle < target)
+            target = input[s.next_input].cycle;
+        if (cpu.cycles < target)
+            cpu.run_for(target - cpu.cycles);
+        while (s.next_input < input.size() && input[s.next_input].cycle <= cpu.cycles) {
+            cpu.gbmemory.set_joypad(input[s.next_input++].pressed);
+        }
+    }
+}
+
+// Both from power-on, stopping at each of `stops` on the way. Fast
+// paths can depend on where a run stops, so replays stop where the
+// first run did.
+static bool replay(side& ref, side& fast, const std::vector<uint64_t>& stops) {
+    if (!power_on(ref, CPU::CORE_INTERPRETER, false) || !power_on(fast, fast_core, true))
+        return false;
+    for (uint64_t stop : stops) {
+        run_to(ref, stop);
+        run_to(fast, stop);
+    }
+    return true;
+}
+
+// What differs between the two, or "" if they match
+static std::string compare(CPU& ref, CPU& fast) {
+    std::ostringstream out;
+
+    ref.gbmemory.sync_events();
+    fast.gbmemory.sync_events();
+
+    out << std::hex;
+    if (ref.cycles != fast.cycles)
+        out << std::dec << "cycles " << ref.cycles << " vs " << fast.cycles << std::hex << "\n";
+    if (ref.registers.A != fast.registers.A)
+        out << "A " << (int)ref.registers.A << " vs " << (int)fast.registers.A << "\n";
+    if (ref.get_F() != fast.get_F())
+        out << "F " << (int)ref.get_F() << " vs " << (int)fast.get_F() << "\n";
+    if (ref.registers.BC != fast.registers.BC)
+        out << "BC " << ref.registers.BC << " vs " << fast.registers.BC << "\n";
+    if (ref.registers.DE != fast.registers.DE)
+        out << "DE " << ref.registers.DE << " vs " << fast.registers.DE << "\n";
+    if (ref.registers.HL != fast.registers.HL)
+        out << "HL " << ref.registers.HL << " vs " << fast.registers.HL << "\n";
+    if (ref.registers.SP != fast.registers.SP)
+        out << "SP " << ref.registers.SP << " vs " << fast.registers.SP << "\n";
+    if (ref.registers.PC != fast.registers.PC)
+        out << "PC " << ref.registers.PC << " vs " << fast.registers.PC << "\n";
+    if (ref.ime != fast.ime || ref.ei_delay != fast.ei_delay)
+        out << "IME/EI " << ref.ime << ref.ei_delay << " vs " << fast.ime << fast.ei_delay << "\n";
+    if (ref.halted != fast.halted || ref.stopped != fast.stopped)
+        out << "HALT/STOP " << ref.halted << ref.stopped << " vs " << fast.halted << fast.stopped << "\n";
+    if (ref.gbmemory.rom_bank != fast.gbmemory.rom_bank || ref.gbmemory.rom_bank0 != fast.gbmemory.rom_bank0)
+        out << "ROM banks " << ref.gbmemory.rom_bank0 << "/" << ref.gbmemory.rom_bank << " vs " << fast.gbmemory.rom_bank0 << "/" << fast.gbmemory.rom_bank << "\n";
+    if (ref.gbmemory.cart.ram_mapped != fast.gbmemory.cart.ram_mapped)
+        out << "cartridge RAM at " << ref.gbmemory.cart.ram_mapped << " vs " << fast.gbmemory.cart.ram_mapped << "\n";
+    if (ref.gbmemory.cart.ram != fast.gbmemory.cart.ram)
+        out << "cartridge RAM differs\n";
+
+    // memoryMap is laid out in address order, bar echo RAM, so offsets
+    // past RAM are addresses less its size
+    const uint8_t* a = (const uint8_t*)&ref.gbmemory.memory_map;
+    const uint8_t* b = (const uint8_t*)&fast.gbmemory.memory_map;
+    const std::size_t echo = offsetof(Memory::memoryMap, sprite_attrib);
+    unsigned shown = 0;
+
+    for (std::size_t i = 0; i < sizeof(Memory::memoryMap) && shown < 8; i++) {
+        std::size_t addr = i < echo ? i : i + 0xFE00 - echo;
+
+        if (a[i] != b[i]) {
+            out << "(" << addr << ") " << (int)a[i] << " vs " << (int)b[i] << "\n";
+            shown++;
+        }
+    }
+    return out.str();
+}
+
+static refStep next_step(CPU& cpu) {
+    uint16_t pc = cpu.registers.PC;
+    uint8_t opcode = cpu.gbmemory.get_memory(pc);
+    refStep s = {cpu.cycles, pc, (uint16_t)(cpu.registers.A << 8 | cpu.get_F()), cpu.registers.BC, cpu.registers.DE, cpu.registers.HL, cpu.registers.SP, opcode, 0};
+
+    if (op_info[opcode].length == 2)
+        s.arg = cpu.gbmemory.get_memory(pc + 1);
+    else if (op_info[opcode].length == 3)
+        s.arg = cpu.gbmemory.get_memory(pc + 1) | (cpu.gbmemory.get_memory(pc + 2) << 8);
+    return s;
+}
+
+static void print_step(const refStep& s) {
+    std::string text = disassemble(s.pc, s.opcode, s.arg);
+
+    std::printf("%-12llu %04X  %-18s AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X\n",
+                (unsigned long long)s.cycles, s.pc, text.c_str(), s.af, s.bc, s.de, s.hl, s.sp);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <ROM file> [-c T-cycles] [-i input log] [-k interpreter|blocks|jit|mcycle] [-s T-cycles]" << std::endl;
+        return 1;
+    }
+
+    uint64_t total = 60 * Scheduler::FRAME_CYCLES;
+    uint64_t interval = Scheduler::FRAME_CYCLES;
+
+    rom_path = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        const char* val = argv[i + 1];
+
+        if (opt == "-c") {
+            total = std::strtoull(val, nullptr, 10);
+        }
+        else if (opt == "-s") {
+            interval = std::strtoull(val, nullptr, 10);
+        }
+        else if (opt == "-i") {
+            if (!load_input(val, input)) {
+                std::cout << "Error opening input log \'" << val << "\'" << std::endl;
+                return 1;
+            }
+        }
+        else if (opt == "-k") {
+            std::string name = val;
+
+            fast_core = 0;
+            while (fast_core < CPU::CORE_COUNT && name != CPU::core_names[fast_core])
+                fast_core++;
+            if (fast_core == CPU::CORE_COUNT) {
+                std::cout << "Unknown core \'" << name << "\'" << std::endl;
+                return 1;
+            }
+        }
+    }
+    if (interval == 0)
+        interval = Scheduler::FRAME_CYCLES;
+
+    // Whole states, every `interval` T-cycles
+    side ref, fast;
+    std::vector<uint64_t> stops;
+    std::string diff;
+
+    if (!replay(ref, fast, stops)) {
+        std::cout << "Error opening file \'" << rom_path << "\'" << std::endl;
+        return 1;
+    }
+    while (ref.cpu->cycles < total) {
+        uint64_t until = ref.cpu->cycles + interval < total ? ref.cpu->cycles + interval : total;
+
+        run_to(ref, until);
+        run_to(fast, until);
+        diff = compare(*ref.cpu, *fast.cpu);
+        if (!diff.empty())
+            break;
+        stops.push_back(ref.cpu->cycles);
+    }
+    if (diff.empty()) {
+        std::cout << "No differences in " << ref.cpu->cycles << " T-cycles" << std::endl;
+        return 0;
+    }
+
+    // Halve the stretch it shows up in: from the last stop both agreed
+    // at, run to half way. Differing there, that's the new stretch;
+    // if not, the second half is, unless it's only there run in one go.
+    uint64_t from = stops.empty() ? 0 : stops.back();
+    uint64_t to = ref.cpu->cycles;
+
+    for (;;) {
+        uint64_t mid = from + (to - from) / 2;
+
+        if (mid == from)
+            break;
+
+        replay(ref, fast, stops);
+        run_to(ref, mid);
+        run_to(fast, mid);
+        if (!compare(*ref.cpu, *fast.cpu).empty()) {
+            to = mid;
+            continue;
+        }
+
+        run_to(ref, to);
+        run_to(fast, to);
+        if (compare(*ref.cpu, *fast.cpu).empty())
+            break;
+        stops.push_back(mid);
+        from = mid;
+    }
+
+    // The reference an instruction at a time over the stretch left
+    refStep history[HISTORY];
+    std::size_t steps = 0;
+
+    replay(ref, fast, stops);
+    while (ref.cpu->cycles < to) {
+        if (!ref.cpu->halted)
+            history[steps++ % HISTORY] = next_step(*ref.cpu);
+        run_to(ref, ref.cpu->cycles + 1);
+    }
+    run_to(fast, to);
+    diff = compare(*ref.cpu, *fast.cpu);
+
+    std::cout << "Running from T-cycle " << from << " to " << ref.cpu->cycles << " in one go, states differ (reference vs fast):\n" << diff << "\n";
+    if (steps > HISTORY)
+        std::cout << "(" << steps - HISTORY << " instructions before these)\n";
+    for (std::size_t i = steps > HISTORY ? steps - HISTORY : 0; i < steps; i++) {
+        print_step(history[i % HISTORY]);
+    }
+    return 2;
+}
\ No newline at end of file
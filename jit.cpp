@@ -0,0 +1,604 @@
+/*
+* x86-64 translation of hot blocks for CPU::run_jit()
+*/
+
+#include "jit.h"
+
+#include <cstring>
+
+#include "cpu.h"
+
+#ifdef GBEMU_JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Host registers
+static const int RAX = 0;
+static const int RCX = 1;
+static const int REG_A = 12;  // r12d
+static const int REG_BC = 13; // r13d, then DE in r14d and HL in r15d
+
+// Condition codes for jump()
+static const uint8_t CC_AE = 0x3;
+static const uint8_t CC_E = 0x4;
+static const uint8_t CC_NE = 0x5;
+static const uint8_t CC_ALWAYS = 0xFF;
+
+// Flag lookups called from native code. They only touch F and `lazy`,
+// neither of which are kept in host registers.
+static bool jit_zero(CPU* cpu) {
+    return cpu->zero_flag();
+}
+
+static bool jit_carry(CPU* cpu) {
+    return cpu->carry_flag();
+}
+
+static void jit_keep_carry(CPU* cpu) {
+    cpu->lazy.carry = cpu->carry_flag();
+}
+
+Jit::Jit() {
+    arena = nullptr;
+    used = 0;
+    failed = false;
+}
+
+// Compiled code is tied to the BlockCache it was compiled for,
+// so a copy starts out with no code
+Jit::Jit(const Jit& jit) : Jit() {
+}
+
+Jit& Jit::operator=(const Jit& jit) {
+    return *this;
+}
+
+Jit::~Jit() {
+#ifdef GBEMU_JIT_SUPPORTED
+    if (arena != nullptr)
+        munmap(arena, ARENA_SIZE);
+#endif
+}
+
+// Compile b and point b.code at it. Fails if the host isn't supported
+// or the code arena is full, in which case b keeps being interpreted.
+bool Jit::compile(CPU& cpu, BlockCache::block& b) {
+#ifndef GBEMU_JIT_SUPPORTED
+    return false;
+#else
+    if (failed)
+        return false;
+
+    if (arena == nullptr) {
+        void* mem = mmap(nullptr, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (mem == MAP_FAILED) {
+            failed = true;
+            return false;
+        }
+        arena = (uint8_t*)mem;
+    }
+
+    uint8_t* base = (uint8_t*)&cpu;
+    off.A = (uint8_t*)&cpu.registers.A - base;
+    off.BC = (uint8_t*)&cpu.registers.BC - base;
+    off.DE = (uint8_t*)&cpu.registers.DE - base;
+    off.HL = (uint8_t*)&cpu.registers.HL - base;
+    off.SP = (uint8_t*)&cpu.registers.SP - base;
+    off.PC = (uint8_t*)&cpu.registers.PC - base;
+    off.lazy_op = (uint8_t*)&cpu.lazy.op - base;
+    off.lazy_a = (uint8_t*)&cpu.lazy.a - base;
+    off.lazy_b = (uint8_t*)&cpu.lazy.b - base;
+    off.lazy_carry = (uint8_t*)&cpu.lazy.carry - base;
+    off.lazy_res = (uint8_t*)&cpu.lazy.res - base;
+    off.cycles = (uint8_t*)&cpu.cycles - base;
+    off.instructions = (uint8_t*)&cpu.instructions - base;
+    off.branch_taken = (uint8_t*)&cpu.branch_taken - base;
+    off.breakpoint = (uint8_t*)&cpu.breakpoint - base;
+    off.exit_blocks = (uint8_t*)&cpu.gbmemory.exit_blocks - base;
+
+    buf.clear();
+    exits.clear();
+    in_host = false;
+    dirty = false;
+    flags = LAZY_UNKNOWN;
+    pending = 0;
+    pending_ops = 0;
+    start = b.start;
+    max_cycles = b.max_cycles;
+    loops = b.loop_cycles == 0;
+
+    // push rbx, rbp, r12-r15; sub rsp, 8; mov rbx, rdi; mov rbp, rsi
+    emit({0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57});
+    emit({0x48, 0x83, 0xEC, 0x08});
+    emit({0x48, 0x89, 0xFB, 0x48, 0x89, 0xF5});
+    body = buf.size();
+
+    uint16_t addr = b.start;
+    bool ended = false;
+
+    for (std::size_t i = 0; i < b.ops.size(); i++) {
+        uint16_t next = addr + b.ops[i].len;
+
+        ended = translate(b.ops[i], next, i + 1 == b.ops.size());
+        addr = next;
+    }
+    if (!ended)
+        finish(addr);
+
+    for (std::size_t at : exits) {
+        patch(at);
+    }
+    // add rsp, 8; pop r15-r12, rbp, rbx; ret
+    emit({0x48, 0x83, 0xC4, 0x08});
+    emit({0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B, 0xC3});
+
+    if (used + buf.size() > ARENA_SIZE)
+        return false;
+
+    // No page is writable and executable at once: the ones the block
+    // goes on are writable only while it's copied in. Blocks already
+    // on them can't be running, compile() isn't called from native code.
+    std::size_t page = (std::size_t)sysconf(_SC_PAGESIZE);
+    uint8_t* first = arena + (used & ~(page - 1));
+    std::size_t length = ((used + buf.size() + page - 1) & ~(page - 1)) - (used & ~(page - 1));
+
+    if (mprotect(first, length, PROT_READ | PROT_WRITE) != 0)
+        return false;
+    std::memcpy(arena + used, buf.data(), buf.size());
+    if (mprotect(first, length, PROT_READ | PROT_EXEC) != 0) {
+        failed = true;
+        return false;
+    }
+    b.code = (BlockCache::native)(arena + used);
+    used = (used + buf.size() + 0xF) & ~(std::size_t)0xF;
+    return true;
+#endif
+}
+
+// Private ////////////////////
+
+// Emit one instruction. Returns true if it was the block's last and
+// already left PC and the cycle count set.
+bool Jit::translate(const BlockCache::microOp& op, uint16_t next, bool last) {
+    uint8_t o = op.opcode;
+    uint8_t x = o >> 6;
+    uint8_t y = (o >> 3) & 0x7;
+    uint8_t z = o & 0x7;
+    uint8_t p = y >> 1;
+    uint8_t q = y & 0x1;
+
+    if (op.fused != BlockCache::NOT_FUSED) {
+        call_handler(op, next, last);
+        return last;
+    }
+
+    // JR, JR cc, JP, JP cc
+    if (o == 0x18 || o == 0xC3 || (x == 0 && z == 0 && y >= 4) || (x == 3 && z == 2 && y < 4)) {
+        branch(op, next);
+        return true;
+    }
+
+    if (o == 0x00) {
+        // NOP
+    }
+    else if (x == 1 && y != 6 && z != 6) {
+        // LD r, r
+        load_host();
+        get_r8(z, RAX);
+        set_r8(y);
+        dirty = true;
+        if (o == 0x40)
+            store8_imm(off.breakpoint, 1);
+    }
+    else if (x == 0 && z == 6 && y != 6) {
+        // LD r, n
+        load_host();
+        mov_ri(RAX, op.arg & 0xFF);
+        set_r8(y);
+        dirty = true;
+    }
+    else if (x == 0 && z == 1 && q == 0) {
+        // LD rr, nn
+        if (p == 3) {
+            store16_imm(off.SP, op.arg);
+        }
+        else {
+            load_host();
+            mov_ri(REG_BC + p, op.arg);
+            dirty = true;
+        }
+    }
+    else if (x == 0 && z == 3) {
+        // INC rr, DEC rr
+        if (p == 3) {
+            emit({0x66});
+            modrm_mem(0xFF, q, off.SP);
+        }
+        else {
+            load_host();
+            alu_ri(q ? 5 : 0, REG_BC + p, 1);
+            alu_ri(4, REG_BC + p, 0xFFFF);
+            dirty = true;
+        }
+    }
+    else if (x == 0 && (z == 4 || z == 5) && y != 6) {
+        // INC r, DEC r
+        load_host();
+        keep_carry();
+        get_r8(y, RAX);
+        alu_ri(z == 4 ? 0 : 5, RAX, 1);
+        store8(off.lazy_res, RAX);
+        store8_imm(off.lazy_op, z == 4 ? CPU::FLAGS_INC : CPU::FLAGS_DEC);
+        set_r8(y);
+        dirty = true;
+        flags = LAZY_INCDEC;
+    }
+    else if (((x == 2 && z != 6) || (x == 3 && z == 6)) && y != 1 && y != 3) {
+        // ADD, SUB, AND, XOR, OR, CP with r or n
+        load_host();
+        if (x == 2)
+            get_r8(z, RCX);
+        else
+            mov_ri(RCX, op.arg & 0xFF);
+        modrm_rr(0x89, REG_A, RAX);
+
+        if (y == 0 || y == 2 || y == 7) {
+            store8(off.lazy_a, REG_A);
+            store8(off.lazy_b, RCX);
+            store8_imm(off.lazy_carry, 0);
+            store8_imm(off.lazy_op, y == 0 ? CPU::FLAGS_ADD : CPU::FLAGS_SUB);
+            modrm_rr(y == 0 ? 0x01 : 0x29, RCX, RAX);
+            flags = LAZY_SET;
+        }
+        else {
+            modrm_rr(y == 4 ? 0x21 : y == 5 ? 0x31 : 0x09, RCX, RAX);
+            store8_imm(off.lazy_op, y == 4 ? CPU::FLAGS_AND : CPU::FLAGS_OR);
+            flags = LAZY_CARRY0;
+        }
+        store8(off.lazy_res, RAX);
+
+        if (y != 7) {
+            modrm_rr(0x0F, 0xB6, REG_A, RAX);
+            dirty = true;
+        }
+    }
+    else {
+        call_handler(op, next, last);
+        return last;
+    }
+
+    pending += op.cycles;
+    pending_ops++;
+    return false;
+}
+
+// Run the interpreter's handler for this instruction, with the CPU
+// object up to date and PC already past it as in CPU::step(). Fused
+// handlers count their own instructions.
+void Jit::call_handler(const BlockCache::microOp& op, uint16_t next, bool last) {
+    bool conditional = op.cycles_branch != op.cycles;
+
+    store_host();
+    in_host = false;
+    store16_imm(off.PC, next);
+    add_cycles(pending);
+    add_instructions(pending_ops + (op.fused == BlockCache::NOT_FUSED));
+    pending = 0;
+    pending_ops = 0;
+    if (conditional)
+        store8_imm(off.branch_taken, 0);
+
+    emit({0x48, 0x89, 0xDF}); // mov rdi, rbx
+    mov_ri(6, op.arg);        // mov esi, arg
+    if (op.fused != BlockCache::NOT_FUSED)
+        call((const void*)CPU::fused_thunks[op.fused]);
+    else
+        call((const void*)CPU::thunks[op.opcode]);
+
+    add_cycles(op.cycles);
+    if (conditional) {
+        cmp8_imm(off.branch_taken, 0);
+        std::size_t at = jump(CC_E);
+        add_cycles(op.cycles_branch - op.cycles);
+        patch(at);
+    }
+    flags = LAZY_UNKNOWN;
+
+    // Leave if the handler wrote code that may be running, or IE/IF
+    if (!last) {
+        cmp8_imm(off.exit_blocks, 0);
+        exits.push_back(jump(CC_NE));
+    }
+}
+
+// JR/JP (cc) ending the block, with the target known at compile time
+void Jit::branch(const BlockCache::microOp& op, uint16_t next) {
+    uint8_t y = (op.opcode >> 3) & 0x7;
+    uint16_t target = op.opcode < 0x40 ? next + (int8_t)op.arg : op.arg;
+
+    if (op.opcode == 0x18 || op.opcode == 0xC3) {
+        store_host();
+        store16_imm(off.PC, target);
+        add_cycles(pending + op.cycles);
+        add_instructions(pending_ops + 1);
+        pending = 0;
+        pending_ops = 0;
+        loop_back(target);
+        return;
+    }
+
+    // al = Z or C
+    if ((y & 0x2) == 0 && flags != LAZY_UNKNOWN) {
+        cmp8_imm(off.lazy_res, 0);
+        emit({0x0F, 0x94, 0xC0}); // sete al
+    }
+    else if ((y & 0x2) != 0 && flags == LAZY_CARRY0) {
+        mov_ri(RAX, 0);
+    }
+    else if ((y & 0x2) != 0 && flags == LAZY_INCDEC) {
+        load8(RAX, off.lazy_carry);
+    }
+    else {
+        emit({0x48, 0x89, 0xDF}); // mov rdi, rbx
+        call((y & 0x2) == 0 ? (const void*)jit_zero : (const void*)jit_carry);
+    }
+    store_host();
+
+    // NZ/NC are taken when al is 0, Z/C when it isn't
+    emit({0x84, 0xC0}); // test al, al
+    std::size_t taken = jump((y & 0x1) ? CC_NE : CC_E);
+    store16_imm(off.PC, next);
+    add_cycles(pending + op.cycles);
+    add_instructions(pending_ops + 1);
+    exits.push_back(jump(CC_ALWAYS));
+
+    patch(taken);
+    store16_imm(off.PC, target);
+    add_cycles(pending + op.cycles_branch);
+    add_instructions(pending_ops + 1);
+    pending = 0;
+    pending_ops = 0;
+    loop_back(target);
+}
+
+// Branch to the top of the block again if it jumps to its own start and
+// a full pass still ends short of the target (kept in rbp)
+void Jit::loop_back(uint16_t target) {
+    if (target != start || !loops)
+        return;
+
+    emit({0x48}); // mov rax, [rbx + cycles]
+    modrm_mem(0x8B, RAX, off.cycles);
+    emit({0x48, 0x05}); // add rax, max_cycles
+    emit32(max_cycles);
+    emit({0x48, 0x39, 0xE8}); // cmp rax, rbp
+
+    std::size_t at = jump(0x2); // jb body
+    int32_t rel = (int32_t)(body - (at + 4));
+    std::memcpy(&buf[at], &rel, 4);
+    flags = LAZY_UNKNOWN;
+}
+
+// Before INC/DEC r: set lazy.carry to the current carry flag, which
+// only needs working out if the last flag-setting op wasn't INC/DEC
+void Jit::keep_carry() {
+    if (flags == LAZY_INCDEC)
+        return;
+
+    if (flags == LAZY_CARRY0) {
+        store8_imm(off.lazy_carry, 0);
+        return;
+    }
+
+    cmp8_imm(off.lazy_op, CPU::FLAGS_INC);
+    std::size_t at = jump(CC_AE);
+    emit({0x48, 0x89, 0xDF}); // mov rdi, rbx
+    call((const void*)jit_keep_carry);
+    patch(at);
+}
+
+// Block ran off its end without a branch
+void Jit::finish(uint16_t next) {
+    store_host();
+    store16_imm(off.PC, next);
+    add_cycles(pending);
+    add_instructions(pending_ops);
+    pending = 0;
+    pending_ops = 0;
+}
+
+void Jit::load_host() {
+    if (in_host)
+        return;
+
+    load8(REG_A, off.A);
+    load16(REG_BC, off.BC);
+    load16(REG_BC + 1, off.DE);
+    load16(REG_BC + 2, off.HL);
+    in_host = true;
+    dirty = false;
+}
+
+void Jit::store_host() {
+    if (!in_host || !dirty)
+        return;
+
+    store8(off.A, REG_A);
+    store16(off.BC, REG_BC);
+    store16(off.DE, REG_BC + 1);
+    store16(off.HL, REG_BC + 2);
+    dirty = false;
+}
+
+// 8-bit register r (B C D E H L - A) into eax or ecx
+void Jit::get_r8(uint8_t r, int dst) {
+    int pair = REG_BC + (r >> 1);
+
+    if (r == 7) {
+        modrm_rr(0x89, REG_A, dst);
+    }
+    else if (r & 0x1) {
+        modrm_rr(0x0F, 0xB6, dst, pair);
+    }
+    else {
+        modrm_rr(0x89, pair, dst);
+        shift_ri(5, dst, 8);
+    }
+}
+
+// al into 8-bit register r, clobbering eax
+void Jit::set_r8(uint8_t r) {
+    int pair = REG_BC + (r >> 1);
+
+    if (r == 7) {
+        modrm_rr(0x0F, 0xB6, REG_A, RAX);
+    }
+    else if (r & 0x1) {
+        modrm_rr(0x88, RAX, pair);
+    }
+    else {
+        modrm_rr(0x0F, 0xB6, RAX, RAX);
+        shift_ri(4, RAX, 8);
+        alu_ri(4, pair, 0xFF);
+        modrm_rr(0x09, RAX, pair);
+    }
+}
+
+void Jit::add_cycles(uint32_t n) {
+    if (n == 0)
+        return;
+
+    emit({0x48}); // add qword [rbx + cycles], n
+    modrm_mem(0x81, 0, off.cycles);
+    emit32(n);
+}
+
+void Jit::add_instructions(uint32_t n) {
+    if (n == 0)
+        return;
+
+    emit({0x48}); // add qword [rbx + instructions], n
+    modrm_mem(0x81, 0, off.instructions);
+    emit32(n);
+}
+
+void Jit::call(const void* fn) {
+    uint64_t addr = (uint64_t)fn;
+
+    emit({0x48, 0xB8}); // mov rax, fn; call rax
+    for (int i = 0; i < 8; i++) {
+        buf.push_back((addr >> (i * 8)) & 0xFF);
+    }
+    emit({0xFF, 0xD0});
+}
+
+void Jit::emit(std::initializer_list<uint8_t> bytes) {
+    buf.insert(buf.end(), bytes);
+}
+
+void Jit::emit32(uint32_t val) {
+    emit({(uint8_t)val, (uint8_t)(val >> 8), (uint8_t)(val >> 16), (uint8_t)(val >> 24)});
+}
+
+void Jit::rex(bool w, int reg, int rm) {
+    uint8_t prefix = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+
+    if (prefix != 0x40)
+        emit({prefix});
+}
+
+void Jit::modrm_rr(uint8_t op, int reg, int rm) {
+    rex(false, reg, rm);
+    emit({op, (uint8_t)(0xC0 | ((reg & 0x7) << 3) | (rm & 0x7))});
+}
+
+void Jit::modrm_rr(uint8_t op0, uint8_t op1, int reg, int rm) {
+    rex(false, reg, rm);
+    emit({op0, op1, (uint8_t)(0xC0 | ((reg & 0x7) << 3) | (rm & 0x7))});
+}
+
+// [rbx + disp32]
+void Jit::modrm_mem(uint8_t op, int reg, int32_t disp) {
+    rex(false, reg, 0);
+    emit({op, (uint8_t)(0x83 | ((reg & 0x7) << 3))});
+    emit32(disp);
+}
+
+void Jit::modrm_mem(uint8_t op0, uint8_t op1, int reg, int32_t disp) {
+    rex(false, reg, 0);
+    emit({op0, op1, (uint8_t)(0x83 | ((reg & 0x7) << 3))});
+    emit32(disp);
+}
+
+// shl (4) / shr (5) r32, n
+void Jit::shift_ri(int ext, int r, uint8_t n) {
+    modrm_rr(0xC1, ext, r);
+    emit({n});
+}
+
+// add (0) / or (1) / and (4) / sub (5) r32, imm32
+void Jit::alu_ri(int ext, int r, uint32_t imm) {
+    modrm_rr(0x81, ext, r);
+    emit32(imm);
+}
+
+void Jit::mov_ri(int r, uint32_t imm) {
+    rex(false, 0, r);
+    emit({(uint8_t)(0xB8 + (r & 0x7))});
+    emit32(imm);
+}
+
+void Jit::store8(int32_t disp, int r) {
+    modrm_mem(0x88, r, disp);
+}
+
+void Jit::store8_imm(int32_t disp, uint8_t imm) {
+    modrm_mem(0xC6, 0, disp);
+    emit({imm});
+}
+
+void Jit::store16(int32_t disp, int r) {
+    emit({0x66});
+    modrm_mem(0x89, r, disp);
+}
+
+void Jit::store16_imm(int32_t disp, uint16_t imm) {
+    emit({0x66});
+    modrm_mem(0xC7, 0, disp);
+    emit({(uint8_t)imm, (uint8_t)(imm >> 8)});
+}
+
+// movzx r32, byte [rbx + disp]
+void Jit::load8(int r, int32_t disp) {
+    modrm_mem(0x0F, 0xB6, r, disp);
+}
+
+// movzx r32, word [rbx + disp]
+void Jit::load16(int r, int32_t disp) {
+    modrm_mem(0x0F, 0xB7, r, disp);
+}
+
+void Jit::cmp8_imm(int32_t disp, uint8_t imm) {
+    modrm_mem(0x80, 7, disp);
+    emit({imm});
+}
+
+// jcc/jmp rel32, returning where the offset goes for patch()
+std::size_t Jit::jump(uint8_t cc) {
+    if (cc == CC_ALWAYS)
+        emit({0xE9});
+    else
+        emit({0x0F, (uint8_t)(0x80 | cc)});
+
+    emit32(0);
+    return buf.size() - 4;
+}
+
+// Point the jump at `at` to the current end of the code
+void Jit::patch(std::size_t at) {
+    int32_t rel = (int32_t)(buf.size() - (at + 4));
+
+    std::memcpy(&buf[at], &rel, 4);
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#ifndef JIT_H
+#define JIT_H
+
+// C++ libraries
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// GBemu sources
+#include "blockcache.h"
+
+// Native code is only generated for x86-64 System V hosts; everywhere
+// else compile() always fails and CORE_JIT runs plain cached blocks
+#if defined(__x86_64__) && defined(__unix__)
+#define GBEMU_JIT_SUPPORTED
+#endif
+
+class CPU;
+
+// Translates hot ROM blocks into x86-64. A, BC, DE and HL live in
+// r12-r15 for the length of a block; loads/stores, stack, I/O, CB and
+// anything else without a native translation call the interpreter's
+// handler for that OP code with the registers written back first.
+// A block that branches back to its own start keeps looping in native
+// code for as long as another pass can't reach the cycle target, unless
+// it could be an idle loop, which goes back to CPU::run_jit() each pass.
+class Jit {
+    public:
+    static const uint32_t HOT_THRESHOLD = 16;      // Block lookups before compiling
+    static const std::size_t ARENA_SIZE = 1 << 22; // Bytes of native code per CPU
+
+    Jit();
+    Jit(const Jit& jit);
+    Jit& operator=(const Jit& jit);
+    ~Jit();
+    bool compile(CPU& cpu, BlockCache::block& b);
+
+    private:
+    // Where each piece of CPU state is, relative to the CPU object
+    struct offsets {
+        int32_t A, BC, DE, HL, SP, PC;
+        int32_t lazy_op, lazy_a, lazy_b, lazy_carry, lazy_res;
+        int32_t cycles, instructions, branch_taken, breakpoint, exit_blocks;
+    } off;
+
+    // What the block's code so far has left in `lazy`
+    enum flagState : uint8_t {
+        LAZY_UNKNOWN, // Anything, including FLAGS_NONE
+        LAZY_SET,     // Not FLAGS_NONE, so Z is lazy.res == 0
+        LAZY_CARRY0,  // AND/OR/XOR, carry is clear
+        LAZY_INCDEC   // INC/DEC, carry is in lazy.carry
+    };
+
+    uint8_t* arena;
+    std::size_t used;
+    bool failed; // Arena could not be mapped
+    std::vector<uint8_t> buf;
+    std::vector<std::size_t> exits; // rel32 jumps to patch to the epilogue
+
+    // Block state while compiling
+    bool in_host;        // r12-r15 hold the registers
+    bool dirty;          // ...and differ from the CPU object
+    uint8_t flags;       // flagState
+    uint32_t pending;    // T-cycles of native OP codes not yet added
+    uint32_t pending_ops; // ...and how many of them there are
+    std::size_t body;    // Where the block's code starts, after the prologue
+    uint16_t start;      // The block's start and max_cycles
+    uint16_t max_cycles;
+    bool loops;          // Self-loops run natively, see BlockCache::block::loop_cycles
+
+    bool translate(const BlockCache::microOp& op, uint16_t next, bool last);
+    void call_handler(const BlockCache::microOp& op, uint16_t next, bool last);
+    void branch(const BlockCache::microOp& op, uint16_t next);
+    void keep_carry();
+    void loop_back(uint16_t target);
+    void finish(uint16_t next);
+
+    void load_host();
+    void store_host();
+    void get_r8(uint8_t r, int dst);
+    void set_r8(uint8_t r);
+    void add_cycles(uint32_t n);
+    void add_instructions(uint32_t n);
+    void call(const void* fn);
+
+    // x86-64 encoding
+    void emit(std::initializer_list<uint8_t> bytes);
+    void emit32(uint32_t val);
+    void rex(bool w, int reg, int rm);
+    void modrm_rr(uint8_t op, int reg, int rm);
+    void modrm_rr(uint8_t op0, uint8_t op1, int reg, int rm);
+    void modrm_mem(uint8_t op, int reg, int32_t disp);
+    void modrm_mem(uint8_t op0, uint8_t op1, int reg, int32_t disp);
+    void shift_ri(int ext, int r, uint8_t n);
+    void alu_ri(int ext, int r, uint32_t imm);
+    void mov_ri(int r, uint32_t imm);
+    void store8(int32_t disp, int r);
+    void store8_imm(int32_t disp, uint8_t imm);
+    void store16(int32_t disp, int r);
+    void store16_imm(int32_t disp, uint16_t imm);
+    void load8(int r, int32_t disp);
+    void load16(int r, int32_t disp);
+    void cmp8_imm(int32_t disp, uint8_t imm);
+    std::size_t jump(uint8_t cc);
+    void patch(std::size_t at);
+};
+
+#endif
\ No newline at end of file
@@ -46,9 +46,31 @@ int main(int argc, char** argv) {
     /////////////////////
     // Gameboy startup //
     /////////////////////
+    // After the ROM: -k <core> (see CPU::core_names), and with
+    // GBEMU_PROFILE where to save the profile, .json or .csv
+    std::string profilePath = "profile.csv";
+
+    for (int i = 2; i < argc; i++) {
+        std::string opt = argv[i];
+
+        if (opt == "-k" && i + 1 < argc) {
+            std::string name = argv[++i];
+
+            cpu.core = 0;
+            while (cpu.core < CPU::CORE_COUNT && name != CPU::core_names[cpu.core])
+                cpu.core++;
+            if (cpu.core == CPU::CORE_COUNT) {
+                std::cout << "Unknown core \'" << name << "\'" << std::endl;
+                exit();
+                std::exit(1);
+            }
+        }
+        else {
+            profilePath = opt;
+        }
+    }
+
     loadROM(argv[1]);
-    new (&memory) Memory();
-    CPU cpu(memory);
 
     ///////////////
     // Main loop //
@@ -66,6 +88,11 @@ int main(int argc, char** argv) {
         syncFramerate();
         ++frameCount;
     }
+
+#ifdef GBEMU_PROFILE
+    if (!cpu.profiler.write(profilePath))
+        std::cout << "Error writing profile '" << profilePath << "'" << std::endl;
+#endif
     std::exit(0);
 }
 
@@ -80,21 +107,13 @@ void exit() {
     SDL_Quit();
 }
 
-// Load from into memory from file
+// Put the cartridge in from a ROM file
 void loadROM(char* arg) {
-    rom.open(arg, std::ios::binary | std::ios::in);
-    if (!rom.is_open()) {
+    if (!cpu.gbmemory.load_rom(arg)) {
         std::cout << "Error opening file \'" << arg << "\'" << std::endl;
         exit();
+        std::exit(1);
     }
-
-    new (&rombytes) std::vector<uint8_t>((std::istreambuf_iterator<char>(rom)), std::istreambuf_iterator<char>());
-
-    for (auto i = 0; i < rombytes.size(); ++i) {
-        memory.set_memory(i, rombytes[i]);
-    }
-    rom.close();
-    free (&rombytes);
 }
 
 // Initialize SDL display
@@ -141,17 +160,10 @@ void handleEvents() {
     }
 }
 
-// OPcodes
+// Part of main loop.
+// Runs the CPU for one frame's worth of cycles
 void handleCPU() {
-    auto i = cpu.swap_endian(cpu.registers.PC);
-    // Prefix byte
-    if (rombytes[i] == 0xDD || rombytes[i] == 0xED || rombytes[i] == 0xFD) {
-        cpu.inc_16bit(cpu.registers.PC);
-    }
-    // CB
-    if (rombytes[i] == 0xCB) {
-        //cpu.opcodes[0xCB](rombytes[++i], rombytes[++i]);
-    }
+    cpu.run_for(CYCLES_PER_FRAME);
 }
 
 // Part of main loop
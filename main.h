@@ -3,11 +3,8 @@
 
 // C++ libraries
 #include <cmath>
-#include <fstream>
-#include <ios>
 #include <iostream>
 #include <sstream>
-#include <vector>
 
 // SDL libraries
 #include <SDL2/SDL.h>
@@ -20,12 +17,13 @@
 #include "memory.h"
 #include "timer.h"
 
+// T-cycles in one 59.7 Hz LCD frame
+const uint32_t CYCLES_PER_FRAME = 70224;
+
 bool quit;
 uint64_t frameCount;
 uint32_t tickCount;
 std::stringstream fpsText;
-std::vector<uint8_t> rombytes;
-std::ifstream rom;
 
 SDL_Window* window = NULL;
 SDL_Renderer* renderer = NULL;
@@ -37,7 +35,6 @@ SDL_Texture* fpsDisplayTexture = NULL;
 TTF_Font* font = NULL;
 
 CPU cpu;
-Memory memory;
 Display display;
 Timer framesTimer;
 Timer frameTimer;
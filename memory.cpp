@@ -5,13 +5,22 @@
 
 #include "memory.h"
 
+#include <fstream>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // Entire memory map (524KB address space)
 //    uint8_t ROMbank0[0x4000];      0x0000 - 0x3FFF
 //    uint8_t ROMbank_sw[0x4000];    0x4000 - 0x7FFF
 //    uint8_t vRAM[0x2000];          0x8000 - 0x9FFF
 //    uint8_t sw_RAM[0x2000];        0xA000 - 0xBFFF
 //    uint8_t RAM[0x2000];           0xC000 - 0xDFFF
-//    uint8_t echo_RAM[0x1E00];      0xE000 - 0xFDFF
+//    (echo of RAM)                  0xE000 - 0xFDFF
 //    uint8_t sprite_attrib[0x100];  0xFE00 - 0xFEFF
 //    uint8_t IO_ports[0x80];        0xFF00 - 0xFF7F
 //    uint8_t RAM2[0x80];            0xFF80 - 0xFFFF
@@ -20,6 +29,33 @@ struct Memory::memoryMap memory_map;
 // Initialize memory to boot-up state
 Memory::Memory() {
     fill_zeroes(memory_map);
+    clock = nullptr;
+    polled = 0x00;
+    irq_check = nullptr;
+    ime = nullptr;
+    ei_delay = nullptr;
+    joypad = 0x00;
+    serial_out = nullptr;
+    rom_bank = 1;
+    rom_bank0 = 0;
+    cart.rom_banks = 0;
+    cart.mbc = MBC_NONE;
+    cart.ram_enabled = false;
+    cart.bank_low = 0;
+    cart.bank_high = 0;
+    cart.ram_bank = 0;
+    cart.mode = false;
+    for (uint8_t& reg : cart.rtc) {
+        reg = 0;
+    }
+    cart.ram_mapped = -1;
+    exit_blocks = false;
+    for (std::size_t i = 0; i < 0x100; i++) {
+        code_pages[i] = false;
+        dirty_pages[i] = false;
+    }
+
+    set_memory(0xFF26, 0x80); // Sound on first, or the rest are ignored
     set_memory(0xFF10, 0x80);
     set_memory(0xFF11, 0x88);
     set_memory(0xFF12, 0xF3);
@@ -34,7 +70,7 @@ Memory::Memory() {
     set_memory(0xFF23, 0xBF);
     set_memory(0xFF24, 0x77);
     set_memory(0xFF25, 0xF3);
-    set_memory(0xFF26, 0xF1);
+    memory_map.IO_ports[0x26] = 0xF1; // Only channel 1 still playing the boot sound
     set_memory(0xFF40, 0x91);
     set_memory(0xFF47, 0xFC);
     set_memory(0xFF48, 0xFF);
@@ -45,89 +81,550 @@ Memory Memory::operator=(Memory& mem) {
     return mem;
 }
 
-// GB is little-endian
-void Memory::set_memory(uint16_t addr, uint8_t val) {
-    if (addr < 0x4000) {
-        memory_map.ROMbank0[addr] = val;
+// A ROM file mapped read-only: nothing is copied, pages are only read
+// in as they're used, and every process running the same ROM shares
+// them through the page cache. Files that don't end on a bank, or are
+// under 32 KiB, get nullptr, as reads past the end of a mapping fault.
+static std::shared_ptr<const uint8_t> map_rom(const std::string& path, std::size_t& banks) {
+#ifdef __unix__
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+
+    if (fd < 0)
+        return nullptr;
+    if (fstat(fd, &st) != 0 || st.st_size < 0x8000 || st.st_size % 0x4000 != 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    std::size_t size = (std::size_t)st.st_size;
+    void* mem = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping outlives the descriptor
+    close(fd);
+    if (mem == MAP_FAILED)
+        return nullptr;
+    banks = size / 0x4000;
+    return std::shared_ptr<const uint8_t>((const uint8_t*)mem, [size](const uint8_t* p) {
+        munmap((void*)p, size);
+    });
+#else
+    return nullptr;
+#endif
+}
+
+// A ROM file read into memory, a last partial bank or ROMs under 32 KiB
+// padded with zeroes
+static std::shared_ptr<const uint8_t> read_rom(const std::string& path, std::size_t& banks) {
+    std::ifstream file(path, std::ios::binary | std::ios::in | std::ios::ate);
+
+    if (!file.is_open())
+        return nullptr;
+
+    std::size_t size = (std::size_t)file.tellg();
+    uint8_t* rom;
+
+    banks = size > 0x8000 ? (size + 0x3FFF) / 0x4000 : 2;
+    rom = new uint8_t[banks * 0x4000]();
+    file.seekg(0);
+    file.read((char*)rom, size);
+    return std::shared_ptr<const uint8_t>(rom, std::default_delete<const uint8_t[]>());
+}
+
+// Put a cartridge in, with the whole of its ROM from a file, mapped if
+// it can be, and the MBC and RAM its header asks for
+bool Memory::load_rom(const std::string& path) {
+    std::size_t banks = 0;
+    std::shared_ptr<const uint8_t> image = map_rom(path, banks);
+
+    if (image == nullptr)
+        image = read_rom(path, banks);
+    if (image == nullptr)
+        return false;
+
+    const uint8_t* rom = image.get();
+
+    cart.rom = image;
+    cart.rom_banks = banks;
+
+    // clang-format off
+    static const std::size_t ram_sizes[6] = {0, 0x2000, 0x2000, 0x8000, 0x20000, 0x10000};
+    // clang-format on
+
+    switch (rom[0x0147]) {
+    case (0x01):
+    case (0x02):
+    case (0x03):
+        cart.mbc = MBC_1;
+        break;
+    case (0x0F):
+    case (0x10):
+    case (0x11):
+    case (0x12):
+    case (0x13):
+        cart.mbc = MBC_3;
+        break;
+    case (0x19):
+    case (0x1A):
+    case (0x1B):
+    case (0x1C):
+    case (0x1D):
+    case (0x1E):
+        cart.mbc = MBC_5;
+        break;
+    default:
+        // ROM only, or an MBC that isn't emulated: the first 32 KiB
+        cart.mbc = MBC_NONE;
+        break;
+    }
+    cart.ram.assign(rom[0x0149] < 6 ? ram_sizes[rom[0x0149]] : 0, 0);
+    cart.ram_enabled = cart.mbc == MBC_NONE;
+    cart.bank_low = 0;
+    cart.bank_high = 0;
+    cart.ram_bank = 0;
+    cart.mode = false;
+
+    // Pages read before point at memory_map; ROM fills in again from
+    // the image as it's read
+    for (std::size_t page = 0x00; page < 0xC0; page++) {
+        pages.read[page] = nullptr;
+        pages.write[page] = nullptr;
     }
-    else if (addr < 0x8000) {
-        memory_map.ROMbank_sw[addr - 0x4000] = val;
+    rom_bank = 1;
+    rom_bank0 = 0;
+    cart.ram_mapped = -1;
+    map_banks();
+    return true;
+}
+
+// Bring timer, LCD and serial registers up to the current cycle
+void Memory::sync_events() {
+    events.sync(now(), memory_map.IO_ports);
+}
+
+// Cycle the next interrupt request is raised at, or Scheduler::NEVER
+uint64_t Memory::next_event() {
+    return events.next_event(now(), memory_map.IO_ports);
+}
+
+// Cycle a timed register following any of `sources` (Scheduler::SOURCE_*)
+// next changes by itself, or Scheduler::NEVER
+uint64_t Memory::next_change(uint8_t sources) {
+    return events.next_change(sources, now(), memory_map.IO_ports);
+}
+
+// Requested and enabled interrupts (IF & IE)
+uint8_t Memory::pending_interrupts() {
+    return memory_map.IO_ports[0x0F] & memory_map.RAM2[0x7F] & 0x1F;
+}
+
+// Clear an IF bit once the CPU has jumped to its handler
+void Memory::acknowledge(uint8_t irq) {
+    events.sync(now(), memory_map.IO_ports);
+    memory_map.IO_ports[0x0F] &= ~irq;
+}
+
+// Press and release buttons: `pressed` is every JOYPAD_* bit held from
+// now on. A selected P1 line going low requests the joypad interrupt.
+void Memory::set_joypad(uint8_t pressed) {
+    uint8_t before = joypad_lines();
+
+    joypad = pressed;
+    if (joypad_lines() & ~before) {
+        events.sync(now(), memory_map.IO_ports);
+        memory_map.IO_ports[0x0F] |= Scheduler::IRQ_JOYPAD;
+        interrupts_changed();
     }
-    else if (addr < 0xA000) {
-        memory_map.vRAM[addr - 0x8000] = val;
+}
+
+// clang-format off
+constexpr std::array<Memory::ioRegister, 0x80> Memory::build_io_registers() {
+    std::array<ioRegister, 0x80> r = {};
+
+    r[0x00] = {&Memory::read_P1,    nullptr,               0x00};                     // P1
+    r[0x02] = {&Memory::read_timed, &Memory::write_SC,     Scheduler::SOURCE_SERIAL}; // SC
+    r[0x04] = {&Memory::read_timed, &Memory::write_timed,  Scheduler::SOURCE_DIV};    // DIV
+    r[0x05] = {&Memory::read_timed, &Memory::write_timed,  Scheduler::SOURCE_TIMER};  // TIMA
+    r[0x06] = {nullptr,             &Memory::write_timed,  0x00};                     // TMA
+    r[0x07] = {nullptr,             &Memory::write_timed,  0x00};                     // TAC
+    r[0x0F] = {&Memory::read_timed, &Memory::write_IF,     Scheduler::SOURCE_IRQ};    // IF
+    for (uint8_t reg = 0x10; reg < 0x26; reg++) {
+        r[reg] = {nullptr,          &Memory::write_sound,  0x00};                     // NR10 - NR51
     }
-    else if (addr < 0xC000) {
-        memory_map.sw_RAM[addr - 0xA000] = val;
+    r[0x14] = {nullptr,             &Memory::write_trigger, 0x00};                    // NR14
+    r[0x19] = {nullptr,             &Memory::write_trigger, 0x00};                    // NR24
+    r[0x1E] = {nullptr,             &Memory::write_trigger, 0x00};                    // NR34
+    r[0x23] = {nullptr,             &Memory::write_trigger, 0x00};                    // NR44
+    r[0x26] = {&Memory::read_NR52,  &Memory::write_NR52,   0x00};                     // NR52
+    r[0x40] = {nullptr,             &Memory::write_timed,  0x00};                     // LCDC
+    r[0x41] = {&Memory::read_timed, &Memory::write_timed,  Scheduler::SOURCE_LCD};    // STAT
+    r[0x44] = {&Memory::read_timed, &Memory::write_timed,  Scheduler::SOURCE_LCD};    // LY
+    r[0x45] = {nullptr,             &Memory::write_timed,  0x00};                     // LYC
+    r[0x46] = {nullptr,             &Memory::write_DMA,    0x00};                     // DMA
+    return r;
+}
+// clang-format on
+
+// Handlers for 0xFF00 - 0xFF7F, see ioRegister
+const std::array<Memory::ioRegister, 0x80> Memory::io_registers = build_io_registers();
+
+Memory::pageTable::pageTable() {
+    clear();
+}
+
+Memory::pageTable::pageTable(const pageTable& table) : pageTable() {
+}
+
+Memory::pageTable& Memory::pageTable::operator=(const pageTable& table) {
+    clear();
+    return *this;
+}
+
+void Memory::pageTable::clear() {
+    for (std::size_t i = 0; i < 0x100; i++) {
+        read[i] = nullptr;
+        write[i] = nullptr;
     }
-    else if (addr < 0xE000) {
-        memory_map.RAM[addr - 0xC000] = val;
+}
+
+// BlockCache has decoded code from `page`: send its writes, and those
+// to its echo, through write_slow() to catch the code changing
+void Memory::watch_code(uint8_t page) {
+    code_pages[page] = true;
+    pages.write[page] = nullptr;
+    if (page >= 0xC0 && page < 0xDE)
+        pages.write[page + 0x20] = nullptr;
+}
+
+// Private ////////////////////
 
-        if ((addr - 0xC000) < sizeof(memory_map.echo_RAM))
-            memory_map.echo_RAM[addr - 0xC000] = val;
+// Pages set_memory() has no pointer for
+void Memory::write_slow(uint16_t addr, uint8_t val) {
+    // Echo RAM writes land in RAM at 0xC000 - 0xDDFF
+    uint8_t page = (addr >= 0xE000 && addr < 0xFE00 ? addr - 0x2000 : addr) >> 8;
+
+    // Page 0xFF is HRAM as well as I/O registers, which never hold code
+    if (code_pages[page] && (addr < 0xFF00 || addr >= 0xFF80)) {
+        code_pages[page] = false;
+        dirty_pages[page] = true;
+        exit_blocks = true;
     }
-    else if (addr < 0xFE00) {
-        memory_map.RAM[addr - 0xE000] = val;
 
-        if ((addr - 0xC000) < sizeof(memory_map.echo_RAM))
-            memory_map.echo_RAM[addr - 0xE000] = val;
+    if (addr < 0x8000) {
+        if (cart.rom != nullptr)
+            write_mbc(addr, val);
+        else
+            page_bytes(page)[addr & 0xFF] = val;
     }
     else if (addr < 0xFF00) {
-        memory_map.sprite_attrib[addr - 0xFE00] = val;
+        uint8_t* bytes = page_bytes(addr >> 8);
+
+        // Cartridge RAM switched off, or an MBC3 clock register in its place
+        if (bytes == nullptr) {
+            uint8_t* rtc = rtc_register();
+
+            if (rtc != nullptr)
+                *rtc = val;
+            return;
+        }
+        pages.write[addr >> 8] = bytes;
+        bytes[addr & 0xFF] = val;
     }
     else if (addr < 0xFF80) {
-        memory_map.IO_ports[addr - 0xFF00] = val;
+        io_writer write = io_registers[addr & 0x7F].write;
+
+        if (write != nullptr)
+            (this->*write)(addr & 0x7F, val);
+        else
+            memory_map.IO_ports[addr & 0x7F] = val;
     }
-    else if (addr <= 0xFFFF) {
+    else {
         memory_map.RAM2[addr - 0xFF80] = val;
+
+        if (addr == IE)
+            interrupts_changed();
+    }
+}
+
+// I/O registers //////////
+
+// Selected lines read 0 while their button is held
+uint8_t Memory::read_P1(uint8_t reg) {
+    return 0xC0 | (memory_map.IO_ports[0x00] & 0x30) | (~joypad_lines() & 0x0F);
+}
+
+// Registers Scheduler keeps up to date: timer, LCD, serial and IF
+uint8_t Memory::read_timed(uint8_t reg) {
+    events.sync(now(), memory_map.IO_ports);
+    polled |= io_registers[reg].source;
+    return memory_map.IO_ports[reg];
+}
+
+// Writes Scheduler has to see: DIV reset, timer and LCD control. They
+// can bring the next interrupt request forward, past where the CPU
+// last worked out it needs to look, which only matters if it could be
+// serviced.
+void Memory::write_timed(uint8_t reg, uint8_t val) {
+    events.write(0xFF00 | reg, val, now(), memory_map.IO_ports);
+    if (irq_check == nullptr || ime == nullptr || !(*ime || *ei_delay))
+        return;
+    if (events.next_event(now(), memory_map.IO_ports) < *irq_check)
+        interrupts_changed();
+}
+
+// Starting an internally clocked transfer sends SB
+void Memory::write_SC(uint8_t reg, uint8_t val) {
+    if ((val & 0x81) == 0x81 && serial_out != nullptr)
+        serial_out->push_back((char)memory_map.IO_ports[0x01]);
+    write_timed(reg, val);
+}
+
+void Memory::write_IF(uint8_t reg, uint8_t val) {
+    write_timed(reg, val);
+    interrupts_changed();
+}
+
+// Sound registers ignore writes while sound is off (NR52 bit 7)
+void Memory::write_sound(uint8_t reg, uint8_t val) {
+    if (memory_map.IO_ports[0x26] & 0x80)
+        memory_map.IO_ports[reg] = val;
+}
+
+// NRx4: bit 7 (re)starts the channel, which NR52 then shows as on
+void Memory::write_trigger(uint8_t reg, uint8_t val) {
+    if (!(memory_map.IO_ports[0x26] & 0x80))
+        return;
+
+    memory_map.IO_ports[reg] = val;
+    if (val & 0x80)
+        memory_map.IO_ports[0x26] |= 1 << ((reg - 0x14) / 5);
+}
+
+// Bits 4 - 6 aren't there and read 1
+uint8_t Memory::read_NR52(uint8_t reg) {
+    return memory_map.IO_ports[0x26] | 0x70;
+}
+
+// Only the on/off bit can be written. Turning sound off clears every
+// sound register and stops the channels.
+void Memory::write_NR52(uint8_t reg, uint8_t val) {
+    if (!(val & 0x80)) {
+        for (uint8_t i = 0x10; i < 0x26; i++) {
+            memory_map.IO_ports[i] = 0x00;
+        }
+        memory_map.IO_ports[0x26] = 0x00;
     }
     else {
-        std::cerr << "Error: Memory write outside address space \n";
-        std::cerr << "At address " << addr << "\n";
-        std::cerr << "With value " << val << "\n";
-        std::exit(1);
+        memory_map.IO_ports[0x26] |= 0x80;
     }
 }
 
-// GB is little-endian
-uint8_t Memory::get_memory(uint16_t addr) {
-    if (addr < 0x4000) {
-        return memory_map.ROMbank0[addr];
-    }
-    else if (addr < 0x8000) {
-        return memory_map.ROMbank_sw[addr - 0x4000];
+// OAM DMA: copy 160 bytes from val << 8 to OAM, all at once. Sources
+// past WRAM read the echo of it, as on the DMG.
+void Memory::write_DMA(uint8_t reg, uint8_t val) {
+    uint16_t from = (val < 0xE0 ? val : val - 0x20) << 8;
+
+    memory_map.IO_ports[reg] = val;
+    for (uint16_t i = 0; i < 0xA0; i++) {
+        set_memory(0xFE00 + i, get_memory(from + i));
     }
-    else if (addr < 0xA000) {
-        return memory_map.vRAM[addr - 0x8000];
+}
+
+// Pages get_memory() has no pointer for
+uint8_t Memory::read_slow(uint16_t addr) {
+    uint8_t page = addr >> 8;
+
+    if (addr < 0xFF00) {
+        const uint8_t* bytes = addr < 0x8000 ? rom_page(page) : page_bytes(page);
+
+        if (bytes == nullptr) {
+            uint8_t* rtc = rtc_register();
+
+            return rtc != nullptr ? *rtc : 0xFF;
+        }
+        pages.read[page] = bytes;
+        return bytes[addr & 0xFF];
     }
-    else if (addr < 0xC000) {
-        return memory_map.sw_RAM[addr - 0xA000];
+    else if (addr < 0xFF80) {
+        io_reader read = io_registers[addr & 0x7F].read;
+
+        if (read != nullptr)
+            return (this->*read)(addr & 0x7F);
+        return memory_map.IO_ports[addr & 0x7F];
     }
-    else if (addr < 0xE000) {
-        return memory_map.RAM[addr - 0xC000];
+    else {
+        return memory_map.RAM2[addr - 0xFF80];
     }
-    else if (addr < 0xFE00) {
-        return memory_map.RAM[addr - 0xE000];
+}
+
+// Where a page below 0xFF00 is kept, echo RAM being the RAM it mirrors.
+// With a cartridge, ROM is rom_page()'s and RAM is nullptr while it
+// can't be accessed.
+uint8_t* Memory::page_bytes(uint8_t page) {
+    uint16_t addr = page << 8;
+
+    if (cart.rom != nullptr && addr >= 0xA000 && addr < 0xC000)
+        return cart.ram_mapped < 0 ? nullptr : &cart.ram[cart.ram_mapped + addr - 0xA000];
+    else if (addr < 0x4000)
+        return &memory_map.ROMbank0[addr];
+    else if (addr < 0x8000)
+        return &memory_map.ROMbank_sw[addr - 0x4000];
+    else if (addr < 0xA000)
+        return &memory_map.vRAM[addr - 0x8000];
+    else if (addr < 0xC000)
+        return &memory_map.sw_RAM[addr - 0xA000];
+    else if (addr < 0xE000)
+        return &memory_map.RAM[addr - 0xC000];
+    else if (addr < 0xFE00)
+        return &memory_map.RAM[addr - 0xE000];
+    else
+        return &memory_map.sprite_attrib[addr - 0xFE00];
+}
+
+// Where a ROM page is read from, in the banks mapped now
+const uint8_t* Memory::rom_page(uint8_t page) {
+    if (cart.rom == nullptr)
+        return page_bytes(page);
+
+    std::size_t bank = page < 0x40 ? rom_bank0 : rom_bank;
+
+    return cart.rom.get() + bank * 0x4000 + ((page & 0x3F) << 8);
+}
+
+// MBC3 clock register selected in place of RAM, or nullptr
+uint8_t* Memory::rtc_register() {
+    if (cart.mbc != MBC_3 || !cart.ram_enabled || cart.ram_bank < 0x08 || cart.ram_bank > 0x0C)
+        return nullptr;
+    return &cart.rtc[cart.ram_bank - 0x08];
+}
+
+// Writes to 0x0000 - 0x7FFF with a cartridge in: MBC registers
+void Memory::write_mbc(uint16_t addr, uint8_t val) {
+    switch (cart.mbc) {
+    case (MBC_1):
+        if (addr < 0x2000)
+            cart.ram_enabled = (val & 0x0F) == 0x0A;
+        else if (addr < 0x4000)
+            cart.bank_low = val & 0x1F;
+        else if (addr < 0x6000)
+            cart.bank_high = val & 0x03;
+        else
+            cart.mode = val & 0x01;
+        break;
+    case (MBC_3):
+        if (addr < 0x2000)
+            cart.ram_enabled = (val & 0x0F) == 0x0A;
+        else if (addr < 0x4000)
+            cart.bank_low = val & 0x7F;
+        else if (addr < 0x6000)
+            cart.ram_bank = val & 0x0F;
+        // 0x6000 - 0x7FFF latches the clock, which doesn't tick
+        break;
+    case (MBC_5):
+        if (addr < 0x2000)
+            cart.ram_enabled = (val & 0x0F) == 0x0A;
+        else if (addr < 0x3000)
+            cart.bank_low = val;
+        else if (addr < 0x4000)
+            cart.bank_high = val & 0x01;
+        else if (addr < 0x6000)
+            cart.ram_bank = val & 0x0F;
+        break;
+    default:
+        return;
     }
-    else if (addr < 0xFF00) {
-        return memory_map.sprite_attrib[addr - 0xFE00];
+    map_banks();
+}
+
+// Bring rom_bank, rom_bank0 and cart.ram_mapped in line with the MBC
+// registers, repointing the pages of any that changed. Nothing is
+// copied. Blocks have to be left after a ROM bank switch, and code
+// decoded from cartridge RAM is dropped as if it had been written.
+void Memory::map_banks() {
+    std::size_t high = 1;
+    std::size_t low = 0;
+    std::size_t ram_bank = 0;
+
+    switch (cart.mbc) {
+    case (MBC_1):
+        high = cart.bank_high << 5 | (cart.bank_low != 0 ? cart.bank_low : 1);
+        if (cart.mode) {
+            low = cart.bank_high << 5;
+            ram_bank = cart.bank_high;
+        }
+        break;
+    case (MBC_3):
+        high = cart.bank_low != 0 ? cart.bank_low : 1;
+        ram_bank = cart.ram_bank;
+        break;
+    case (MBC_5):
+        high = cart.bank_high << 8 | cart.bank_low;
+        ram_bank = cart.ram_bank;
+        break;
+    default:
+        break;
     }
-    else if (addr < 0xFF80) {
-        return memory_map.IO_ports[addr - 0xFF00];
+
+    bool ram_off = !cart.ram_enabled || cart.ram.empty() || rtc_register() != nullptr;
+    long ram = ram_off ? -1 : (long)(ram_bank * 0x2000 % cart.ram.size());
+
+    high %= cart.rom_banks;
+    low %= cart.rom_banks;
+    if (high != rom_bank) {
+        rom_bank = high;
+        for (std::size_t page = 0x40; page < 0x80; page++) {
+            pages.read[page] = rom_page(page);
+        }
+        exit_blocks = true;
     }
-    else if (addr <= 0xFFFF) {
-        return memory_map.RAM2[addr - 0xFF80];
+    if (low != rom_bank0) {
+        rom_bank0 = low;
+        for (std::size_t page = 0x00; page < 0x40; page++) {
+            pages.read[page] = rom_page(page);
+        }
+        exit_blocks = true;
     }
-    else {
-        std::cerr << "Error: Memory read outside address space \n";
-        std::cerr << "At address " << addr << "\n";
-        std::exit(1);
+    if (ram != cart.ram_mapped) {
+        cart.ram_mapped = ram;
+        for (std::size_t page = 0xA0; page < 0xC0; page++) {
+            if (code_pages[page]) {
+                code_pages[page] = false;
+                dirty_pages[page] = true;
+                exit_blocks = true;
+            }
+            pages.read[page] = page_bytes(page);
+            pages.write[page] = page_bytes(page);
+        }
     }
 }
 
-// Private ////////////////////
+uint64_t Memory::now() {
+    return clock != nullptr ? *clock : 0;
+}
+
+// P1 input lines pulled low (as 1 bits) by held buttons, for whichever
+// of the direction (P14) and button (P15) rows are selected
+uint8_t Memory::joypad_lines() {
+    uint8_t select = memory_map.IO_ports[0x00];
+    uint8_t lines = 0x00;
+
+    if (!(select & 0x10))
+        lines |= joypad & 0x0F;
+    if (!(select & 0x20))
+        lines |= joypad >> 4;
+    return lines;
+}
+
+// An interrupt may have become serviceable: have the CPU look again
+// before its next instruction, leaving any cached code it's running
+void Memory::interrupts_changed() {
+    exit_blocks = true;
+    if (irq_check != nullptr)
+        *irq_check = 0;
+}
 
 // For memory initialization
-void Memory::fill_zeroes(Memory::memoryMap p) {
+void Memory::fill_zeroes(Memory::memoryMap& p) {
     for (std::size_t i = 0; i < sizeof(p.ROMbank0); i++) {
         p.ROMbank0[i] = 0;
     }
@@ -143,9 +640,6 @@ void Memory::fill_zeroes(Memory::memoryMap p) {
     for (std::size_t i = 0; i < sizeof(p.RAM); i++) {
         p.RAM[i] = 0;
     }
-    for (std::size_t i = 0; i < sizeof(p.echo_RAM); i++) {
-        p.echo_RAM[i] = 0;
-    }
     for (std::size_t i = 0; i < sizeof(p.sprite_attrib); i++) {
         p.sprite_attrib[i] = 0;
     }
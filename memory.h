@@ -2,9 +2,16 @@
 #define MEMORY_H
 
 // C++ libraries
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// GBemu sources
+#include "scheduler.h"
 
 class Memory {
     public:
@@ -53,26 +60,163 @@ class Memory {
     const uint16_t IE   = 0xFFFF; // Interrupt enable
     // clang-format on
 
+    // Buttons held, as set_joypad() takes them: P1's direction lines
+    // in the low nibble, its button lines in the high one
+    static const uint8_t JOYPAD_RIGHT = 0x01;
+    static const uint8_t JOYPAD_LEFT = 0x02;
+    static const uint8_t JOYPAD_UP = 0x04;
+    static const uint8_t JOYPAD_DOWN = 0x08;
+    static const uint8_t JOYPAD_A = 0x10;
+    static const uint8_t JOYPAD_B = 0x20;
+    static const uint8_t JOYPAD_SELECT = 0x40;
+    static const uint8_t JOYPAD_START = 0x80;
+
     struct memoryMap {                // (inclusive)
         uint8_t ROMbank0[0x4000];     // 0x0000 - 0x3FFF
         uint8_t ROMbank_sw[0x4000];   // 0x4000 - 0x7FFF
         uint8_t vRAM[0x2000];         // 0x8000 - 0x9FFF
         uint8_t sw_RAM[0x2000];       // 0xA000 - 0xBFFF
         uint8_t RAM[0x2000];          // 0xC000 - 0xDFFF
-        uint8_t echo_RAM[0x1E00];     // 0xE000 - 0xFDFF
+                                      // 0xE000 - 0xFDFF echoes RAM
         uint8_t sprite_attrib[0x100]; // 0xFE00 - 0xFEFF
         uint8_t IO_ports[0x80];       // 0xFF00 - 0xFF7F
         uint8_t RAM2[0x80];           // 0xFF80 - 0xFFFF
     } memory_map;
 
+    uint16_t rom_bank;  // ROM bank mapped at 0x4000 - 0x7FFF
+    uint16_t rom_bank0; // ...and at 0x0000 - 0x3FFF: 0 bar MBC1 mode 1
+
+    // Cartridge controllers, from the header's type byte (0x0147)
+    enum mbcType : uint8_t {
+        MBC_NONE,
+        MBC_1,
+        MBC_3,
+        MBC_5
+    };
+
+    // The cartridge load_rom() put in. Without one, 0x0000 - 0x7FFF and
+    // 0xA000 - 0xBFFF are memory_map's arrays, and writes to ROM land in
+    // them, for building code in place. With one, switching banks only
+    // repoints pages, see map_banks().
+    struct cartridge {
+        std::shared_ptr<const uint8_t> rom; // Whole ROM image, shared by copies; nullptr if none
+        std::size_t rom_banks;              // 16 KiB banks in it, 2 or more
+        std::vector<uint8_t> ram;           // External RAM, every bank
+        uint8_t mbc;                        // mbcType
+        bool ram_enabled;
+        uint8_t bank_low;  // MBC registers as last written: ROM bank (low bits)
+        uint8_t bank_high; // MBC1: RAM bank or ROM bank bits 5-6. MBC5: ROM bank bit 8
+        uint8_t ram_bank;  // MBC3/MBC5: RAM bank, or MBC3 clock register 0x08 - 0x0C
+        bool mode;         // MBC1: bank_high applies to 0x0000 - 0x3FFF and RAM as well
+        uint8_t rtc[5];    // MBC3 clock registers, which don't tick
+        long ram_mapped;   // Offset in `ram` of 0xA000 - 0xBFFF, -1 while it can't be accessed
+    } cart;
+
+    // Where each 256-byte page (addr >> 8) is read from and written to.
+    // read_slow()/write_slow() fill a page in the first time it's used,
+    // if it's plain ROM or RAM; echo RAM pages point at the RAM they
+    // mirror. The rest stay nullptr and go through them every time: I/O
+    // and HRAM, writes to ROM (cartridge registers), cartridge RAM while
+    // it's switched off, and RAM pages with decoded code in them.
+    // A copy starts out empty rather than pointing into another Memory.
+    struct pageTable {
+        const uint8_t* read[0x100];
+        uint8_t* write[0x100];
+
+        pageTable();
+        pageTable(const pageTable& table);
+        pageTable& operator=(const pageTable& table);
+        void clear();
+    } pages;
+
+    // Pages (addr >> 8) of RAM, or of ROM with no cartridge, that BlockCache
+    // has decoded code from, see watch_code(). Writing one marks it dirty
+    // so the cache drops its blocks.
+    bool code_pages[0x100];
+    bool dirty_pages[0x100];
+    bool exit_blocks; // A page in dirty_pages is set, or IE/IF were written
+
+    Scheduler events;
+    const uint64_t* clock;   // CPU T-cycle count, for timed IO registers
+    uint8_t polled;          // Scheduler::SOURCE_* of timed registers read since cleared
+    uint64_t* irq_check;     // CPU cycle interrupts are next looked at, zeroed by IE/IF writes
+    const bool* ime;         // CPU's IME and EI delay: with neither set, no interrupt
+    const bool* ei_delay;    // can be serviced, so timed writes leave irq_check alone
+    uint8_t joypad;          // JOYPAD_* bits of the buttons held
+    std::string* serial_out; // Bytes sent over the serial port get appended, if set
+
+    // Side effects of reading and writing one I/O register, 0xFF00 +
+    // its index in io_registers. Either handler nullptr: a plain byte
+    // in IO_ports.
+    using io_reader = uint8_t (Memory::*)(uint8_t reg);
+    using io_writer = void (Memory::*)(uint8_t reg, uint8_t val);
+
+    struct ioRegister {
+        io_reader read;
+        io_writer write;
+        uint8_t source; // Scheduler::SOURCE_* its value follows, for `polled`
+    };
+
+    static const std::array<ioRegister, 0x80> io_registers;
+
     Memory();
     Memory operator=(Memory& mem);
+    bool load_rom(const std::string& path);
     void set_memory(uint16_t addr, uint8_t val);
     uint8_t get_memory(uint16_t addr);
+    void watch_code(uint8_t page);
+    void sync_events();
+    uint64_t next_event();
+    uint64_t next_change(uint8_t sources);
+    uint8_t pending_interrupts();
+    void acknowledge(uint8_t irq);
+    void set_joypad(uint8_t pressed);
 
     private:
-    void fill_zeroes(memoryMap p);
+    static constexpr std::array<ioRegister, 0x80> build_io_registers();
+
+    // I/O registers with side effects
+    uint8_t read_P1(uint8_t reg);
+    uint8_t read_timed(uint8_t reg);
+    void write_timed(uint8_t reg, uint8_t val);
+    void write_SC(uint8_t reg, uint8_t val);
+    void write_IF(uint8_t reg, uint8_t val);
+    void write_sound(uint8_t reg, uint8_t val);
+    void write_trigger(uint8_t reg, uint8_t val);
+    uint8_t read_NR52(uint8_t reg);
+    void write_NR52(uint8_t reg, uint8_t val);
+    void write_DMA(uint8_t reg, uint8_t val);
+
+    uint8_t read_slow(uint16_t addr);
+    void write_slow(uint16_t addr, uint8_t val);
+    uint8_t* page_bytes(uint8_t page);
+    const uint8_t* rom_page(uint8_t page);
+    uint8_t* rtc_register();
+    void write_mbc(uint16_t addr, uint8_t val);
+    void map_banks();
+    uint64_t now();
+    uint8_t joypad_lines();
+    void interrupts_changed();
+    void fill_zeroes(memoryMap& p);
     void init_stack(memoryMap p);
 };
 
+// GB is little-endian
+inline void Memory::set_memory(uint16_t addr, uint8_t val) {
+    uint8_t* page = pages.write[addr >> 8];
+
+    if (page != nullptr)
+        page[addr & 0xFF] = val;
+    else
+        write_slow(addr, val);
+}
+
+inline uint8_t Memory::get_memory(uint16_t addr) {
+    const uint8_t* page = pages.read[addr >> 8];
+
+    if (page != nullptr)
+        return page[addr & 0xFF];
+    return read_slow(addr);
+}
+
 #endif
\ No newline at end of file
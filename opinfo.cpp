@@ -0,0 +1,72 @@
+/*
+* Disassembly from the OP code table
+*/
+
+#include "opinfo.h"
+
+#include <cstdio>
+#include <cstring>
+
+// Placeholder each operandKind stands in for in a mnemonic
+static const char* placeholder(uint8_t operand) {
+    switch (operand) {
+    case (OPERAND_D8):
+        return "d8";
+    case (OPERAND_D16):
+        return "d16";
+    case (OPERAND_A8):
+        return "a8";
+    case (OPERAND_A16):
+        return "a16";
+    case (OPERAND_R8):
+        return "r8";
+    case (OPERAND_S8):
+        return "s8";
+    default:
+        return nullptr;
+    }
+}
+
+std::string disassemble(uint16_t pc, uint8_t opcode, uint16_t arg) {
+    const opInfo& info = op_info[opcode];
+    char value[16];
+
+    if (info.operand == OPERAND_CB)
+        return op_info[0x100 | (arg & 0xFF)].mnemonic;
+    if (info.mnemonic == nullptr) {
+        std::snprintf(value, sizeof(value), "DB $%02X", opcode);
+        return value;
+    }
+
+    std::string text = info.mnemonic;
+    const char* name = placeholder(info.operand);
+
+    if (name == nullptr)
+        return text;
+
+    std::size_t at = text.find(name);
+
+    switch (info.operand) {
+    case (OPERAND_D8):
+        std::snprintf(value, sizeof(value), "$%02X", arg & 0xFF);
+        break;
+    case (OPERAND_A8):
+        std::snprintf(value, sizeof(value), "$FF%02X", arg & 0xFF);
+        break;
+    case (OPERAND_R8):
+        std::snprintf(value, sizeof(value), "$%04X", (uint16_t)(pc + 2 + (int8_t)arg));
+        break;
+    case (OPERAND_S8):
+        // "SP+s8" reads "SP-5" for negative offsets
+        if (at > 0 && text[at - 1] == '+' && (int8_t)arg < 0) {
+            at--;
+            text.erase(at, 1);
+        }
+        std::snprintf(value, sizeof(value), "%d", (int8_t)arg);
+        break;
+    default:
+        std::snprintf(value, sizeof(value), "$%04X", arg);
+        break;
+    }
+    return text.replace(at, std::strlen(name), value);
+}
\ No newline at end of file
@@ -0,0 +1,237 @@
+#ifndef OPINFO_H
+#define OPINFO_H
+
+// C++ libraries
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// What every OP code looks like from the outside: its length, timing and
+// what kind of operand follows it. op_info[opcode] covers the 256 base
+// OP codes and op_info[0x100 | cbop] the 256 CB-prefixed ones, so the
+// fetch loop, BlockCache, the cycle accounting and disassemble() all read
+// one table. Everything is constexpr, so lookups with a known OP code
+// (CPU::execute<Op>) fold to constants.
+
+enum operandKind : uint8_t {
+    OPERAND_NONE,
+    OPERAND_D8,  // Immediate byte
+    OPERAND_D16, // Immediate word
+    OPERAND_A8,  // 0xFF00 + byte
+    OPERAND_A16, // Address
+    OPERAND_R8,  // JR offset from the next instruction
+    OPERAND_S8,  // Signed byte added to SP
+    OPERAND_CB   // CB-prefixed OP code
+};
+
+struct opInfo {
+    const char* mnemonic;  // Operand as its kind (d8, a16...), nullptr if unused
+    uint8_t length;        // Bytes, including the OP code and any prefix
+    uint8_t cycles;        // T-cycles, branch not taken
+    uint8_t cycles_branch; // T-cycles, branch taken
+    uint8_t operand;       // operandKind
+};
+
+// Instruction length in bytes, including the OP code itself
+constexpr uint8_t base_length[0x100] = {
+    // clang-format off
+//  x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1, // 0x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 1x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 2x
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 3x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 4x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 5x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 6x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 7x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 8x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 9x
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // Ax
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // Bx
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1, // Cx
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1, // Dx
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1, // Ex
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1  // Fx
+    // clang-format on
+};
+
+// T-cycles per instruction (conditional branches: not taken).
+// The CB prefix is 0, its second byte's entry times the whole thing.
+constexpr uint8_t base_cycles[0x100] = {
+    // clang-format off
+//  x0  x1  x2  x3  x4  x5  x6  x7  x8  x9  xA  xB  xC  xD  xE  xF
+    4,  12, 8,  8,  4,  4,  8,  4,  20, 8,  8,  8,  4,  4,  8,  4,  // 0x
+    4,  12, 8,  8,  4,  4,  8,  4,  12, 8,  8,  8,  4,  4,  8,  4,  // 1x
+    8,  12, 8,  8,  4,  4,  8,  4,  8,  8,  8,  8,  4,  4,  8,  4,  // 2x
+    8,  12, 8,  8,  12, 12, 12, 4,  8,  8,  8,  8,  4,  4,  8,  4,  // 3x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // 4x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // 5x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // 6x
+    8,  8,  8,  8,  8,  8,  4,  8,  4,  4,  4,  4,  4,  4,  8,  4,  // 7x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // 8x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // 9x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // Ax
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // Bx
+    8,  12, 12, 16, 12, 16, 8,  16, 8,  16, 12, 0,  12, 24, 8,  16, // Cx
+    8,  12, 12, 4,  12, 16, 8,  16, 8,  16, 12, 4,  12, 4,  8,  16, // Dx
+    12, 12, 8,  4,  4,  16, 8,  16, 16, 4,  16, 4,  4,  4,  8,  16, // Ex
+    12, 12, 8,  4,  4,  16, 8,  16, 12, 8,  16, 4,  4,  4,  8,  16  // Fx
+    // clang-format on
+};
+
+// T-cycles per instruction when a conditional branch is taken
+constexpr uint8_t base_cycles_branch[0x100] = {
+    // clang-format off
+//  x0  x1  x2  x3  x4  x5  x6  x7  x8  x9  xA  xB  xC  xD  xE  xF
+    4,  12, 8,  8,  4,  4,  8,  4,  20, 8,  8,  8,  4,  4,  8,  4,  // 0x
+    4,  12, 8,  8,  4,  4,  8,  4,  12, 8,  8,  8,  4,  4,  8,  4,  // 1x
+    12, 12, 8,  8,  4,  4,  8,  4,  12, 8,  8,  8,  4,  4,  8,  4,  // 2x
+    12, 12, 8,  8,  12, 12, 12, 4,  12, 8,  8,  8,  4,  4,  8,  4,  // 3x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // 4x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // 5x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // 6x
+    8,  8,  8,  8,  8,  8,  4,  8,  4,  4,  4,  4,  4,  4,  8,  4,  // 7x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // 8x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // 9x
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // Ax
+    4,  4,  4,  4,  4,  4,  8,  4,  4,  4,  4,  4,  4,  4,  8,  4,  // Bx
+    20, 12, 16, 16, 24, 16, 8,  16, 20, 16, 16, 0,  24, 24, 8,  16, // Cx
+    20, 12, 16, 4,  24, 16, 8,  16, 20, 16, 16, 4,  24, 4,  8,  16, // Dx
+    12, 12, 8,  4,  4,  16, 8,  16, 16, 4,  16, 4,  4,  4,  8,  16, // Ex
+    12, 12, 8,  4,  4,  16, 8,  16, 12, 8,  16, 4,  4,  4,  8,  16  // Fx
+    // clang-format on
+};
+
+// Operands: d8/d16 immediate, a8 0xFF00 + n, a16 address,
+// r8 relative jump, s8 signed offset. nullptr for unused OP codes.
+constexpr const char* base_mnemonics[0x100] = {
+    // clang-format off
+    "NOP",         "LD BC,d16",   "LD (BC),A",   "INC BC",      "INC B",       "DEC B",       "LD B,d8",     "RLCA",        // 00-07
+    "LD (a16),SP", "ADD HL,BC",   "LD A,(BC)",   "DEC BC",      "INC C",       "DEC C",       "LD C,d8",     "RRCA",        // 08-0F
+    "STOP",        "LD DE,d16",   "LD (DE),A",   "INC DE",      "INC D",       "DEC D",       "LD D,d8",     "RLA",         // 10-17
+    "JR r8",       "ADD HL,DE",   "LD A,(DE)",   "DEC DE",      "INC E",       "DEC E",       "LD E,d8",     "RRA",         // 18-1F
+    "JR NZ,r8",    "LD HL,d16",   "LD (HL+),A",  "INC HL",      "INC H",       "DEC H",       "LD H,d8",     "DAA",         // 20-27
+    "JR Z,r8",     "ADD HL,HL",   "LD A,(HL+)",  "DEC HL",      "INC L",       "DEC L",       "LD L,d8",     "CPL",         // 28-2F
+    "JR NC,r8",    "LD SP,d16",   "LD (HL-),A",  "INC SP",      "INC (HL)",    "DEC (HL)",    "LD (HL),d8",  "SCF",         // 30-37
+    "JR C,r8",     "ADD HL,SP",   "LD A,(HL-)",  "DEC SP",      "INC A",       "DEC A",       "LD A,d8",     "CCF",         // 38-3F
+    "LD B,B",      "LD B,C",      "LD B,D",      "LD B,E",      "LD B,H",      "LD B,L",      "LD B,(HL)",   "LD B,A",      // 40-47
+    "LD C,B",      "LD C,C",      "LD C,D",      "LD C,E",      "LD C,H",      "LD C,L",      "LD C,(HL)",   "LD C,A",      // 48-4F
+    "LD D,B",      "LD D,C",      "LD D,D",      "LD D,E",      "LD D,H",      "LD D,L",      "LD D,(HL)",   "LD D,A",      // 50-57
+    "LD E,B",      "LD E,C",      "LD E,D",      "LD E,E",      "LD E,H",      "LD E,L",      "LD E,(HL)",   "LD E,A",      // 58-5F
+    "LD H,B",      "LD H,C",      "LD H,D",      "LD H,E",      "LD H,H",      "LD H,L",      "LD H,(HL)",   "LD H,A",      // 60-67
+    "LD L,B",      "LD L,C",      "LD L,D",      "LD L,E",      "LD L,H",      "LD L,L",      "LD L,(HL)",   "LD L,A",      // 68-6F
+    "LD (HL),B",   "LD (HL),C",   "LD (HL),D",   "LD (HL),E",   "LD (HL),H",   "LD (HL),L",   "HALT",        "LD (HL),A",   // 70-77
+    "LD A,B",      "LD A,C",      "LD A,D",      "LD A,E",      "LD A,H",      "LD A,L",      "LD A,(HL)",   "LD A,A",      // 78-7F
+    "ADD A,B",     "ADD A,C",     "ADD A,D",     "ADD A,E",     "ADD A,H",     "ADD A,L",     "ADD A,(HL)",  "ADD A,A",     // 80-87
+    "ADC A,B",     "ADC A,C",     "ADC A,D",     "ADC A,E",     "ADC A,H",     "ADC A,L",     "ADC A,(HL)",  "ADC A,A",     // 88-8F
+    "SUB B",       "SUB C",       "SUB D",       "SUB E",       "SUB H",       "SUB L",       "SUB (HL)",    "SUB A",       // 90-97
+    "SBC A,B",     "SBC A,C",     "SBC A,D",     "SBC A,E",     "SBC A,H",     "SBC A,L",     "SBC A,(HL)",  "SBC A,A",     // 98-9F
+    "AND B",       "AND C",       "AND D",       "AND E",       "AND H",       "AND L",       "AND (HL)",    "AND A",       // A0-A7
+    "XOR B",       "XOR C",       "XOR D",       "XOR E",       "XOR H",       "XOR L",       "XOR (HL)",    "XOR A",       // A8-AF
+    "OR B",        "OR C",        "OR D",        "OR E",        "OR H",        "OR L",        "OR (HL)",     "OR A",        // B0-B7
+    "CP B",        "CP C",        "CP D",        "CP E",        "CP H",        "CP L",        "CP (HL)",     "CP A",        // B8-BF
+    "RET NZ",      "POP BC",      "JP NZ,a16",   "JP a16",      "CALL NZ,a16", "PUSH BC",     "ADD A,d8",    "RST 00H",     // C0-C7
+    "RET Z",       "RET",         "JP Z,a16",    "PREFIX CB",   "CALL Z,a16",  "CALL a16",    "ADC A,d8",    "RST 08H",     // C8-CF
+    "RET NC",      "POP DE",      "JP NC,a16",   nullptr,       "CALL NC,a16", "PUSH DE",     "SUB d8",      "RST 10H",     // D0-D7
+    "RET C",       "RETI",        "JP C,a16",    nullptr,       "CALL C,a16",  nullptr,       "SBC A,d8",    "RST 18H",     // D8-DF
+    "LDH (a8),A",  "POP HL",      "LD (C),A",    nullptr,       nullptr,       "PUSH HL",     "AND d8",      "RST 20H",     // E0-E7
+    "ADD SP,s8",   "JP (HL)",     "LD (a16),A",  nullptr,       nullptr,       nullptr,       "XOR d8",      "RST 28H",     // E8-EF
+    "LDH A,(a8)",  "POP AF",      "LD A,(C)",    "DI",          nullptr,       "PUSH AF",     "OR d8",       "RST 30H",     // F0-F7
+    "LD HL,SP+s8", "LD SP,HL",    "LD A,(a16)",  "EI",          nullptr,       nullptr,       "CP d8",       "RST 38H"      // F8-FF
+    // clang-format on
+};
+
+// CB-prefixed OP codes
+constexpr const char* cb_mnemonics[0x100] = {
+    // clang-format off
+    "RLC B",      "RLC C",      "RLC D",      "RLC E",      "RLC H",      "RLC L",      "RLC (HL)",   "RLC A",      // 00-07
+    "RRC B",      "RRC C",      "RRC D",      "RRC E",      "RRC H",      "RRC L",      "RRC (HL)",   "RRC A",      // 08-0F
+    "RL B",       "RL C",       "RL D",       "RL E",       "RL H",       "RL L",       "RL (HL)",    "RL A",       // 10-17
+    "RR B",       "RR C",       "RR D",       "RR E",       "RR H",       "RR L",       "RR (HL)",    "RR A",       // 18-1F
+    "SLA B",      "SLA C",      "SLA D",      "SLA E",      "SLA H",      "SLA L",      "SLA (HL)",   "SLA A",      // 20-27
+    "SRA B",      "SRA C",      "SRA D",      "SRA E",      "SRA H",      "SRA L",      "SRA (HL)",   "SRA A",      // 28-2F
+    "SWAP B",     "SWAP C",     "SWAP D",     "SWAP E",     "SWAP H",     "SWAP L",     "SWAP (HL)",  "SWAP A",     // 30-37
+    "SRL B",      "SRL C",      "SRL D",      "SRL E",      "SRL H",      "SRL L",      "SRL (HL)",   "SRL A",      // 38-3F
+    "BIT 0,B",    "BIT 0,C",    "BIT 0,D",    "BIT 0,E",    "BIT 0,H",    "BIT 0,L",    "BIT 0,(HL)", "BIT 0,A",    // 40-47
+    "BIT 1,B",    "BIT 1,C",    "BIT 1,D",    "BIT 1,E",    "BIT 1,H",    "BIT 1,L",    "BIT 1,(HL)", "BIT 1,A",    // 48-4F
+    "BIT 2,B",    "BIT 2,C",    "BIT 2,D",    "BIT 2,E",    "BIT 2,H",    "BIT 2,L",    "BIT 2,(HL)", "BIT 2,A",    // 50-57
+    "BIT 3,B",    "BIT 3,C",    "BIT 3,D",    "BIT 3,E",    "BIT 3,H",    "BIT 3,L",    "BIT 3,(HL)", "BIT 3,A",    // 58-5F
+    "BIT 4,B",    "BIT 4,C",    "BIT 4,D",    "BIT 4,E",    "BIT 4,H",    "BIT 4,L",    "BIT 4,(HL)", "BIT 4,A",    // 60-67
+    "BIT 5,B",    "BIT 5,C",    "BIT 5,D",    "BIT 5,E",    "BIT 5,H",    "BIT 5,L",    "BIT 5,(HL)", "BIT 5,A",    // 68-6F
+    "BIT 6,B",    "BIT 6,C",    "BIT 6,D",    "BIT 6,E",    "BIT 6,H",    "BIT 6,L",    "BIT 6,(HL)", "BIT 6,A",    // 70-77
+    "BIT 7,B",    "BIT 7,C",    "BIT 7,D",    "BIT 7,E",    "BIT 7,H",    "BIT 7,L",    "BIT 7,(HL)", "BIT 7,A",    // 78-7F
+    "RES 0,B",    "RES 0,C",    "RES 0,D",    "RES 0,E",    "RES 0,H",    "RES 0,L",    "RES 0,(HL)", "RES 0,A",    // 80-87
+    "RES 1,B",    "RES 1,C",    "RES 1,D",    "RES 1,E",    "RES 1,H",    "RES 1,L",    "RES 1,(HL)", "RES 1,A",    // 88-8F
+    "RES 2,B",    "RES 2,C",    "RES 2,D",    "RES 2,E",    "RES 2,H",    "RES 2,L",    "RES 2,(HL)", "RES 2,A",    // 90-97
+    "RES 3,B",    "RES 3,C",    "RES 3,D",    "RES 3,E",    "RES 3,H",    "RES 3,L",    "RES 3,(HL)", "RES 3,A",    // 98-9F
+    "RES 4,B",    "RES 4,C",    "RES 4,D",    "RES 4,E",    "RES 4,H",    "RES 4,L",    "RES 4,(HL)", "RES 4,A",    // A0-A7
+    "RES 5,B",    "RES 5,C",    "RES 5,D",    "RES 5,E",    "RES 5,H",    "RES 5,L",    "RES 5,(HL)", "RES 5,A",    // A8-AF
+    "RES 6,B",    "RES 6,C",    "RES 6,D",    "RES 6,E",    "RES 6,H",    "RES 6,L",    "RES 6,(HL)", "RES 6,A",    // B0-B7
+    "RES 7,B",    "RES 7,C",    "RES 7,D",    "RES 7,E",    "RES 7,H",    "RES 7,L",    "RES 7,(HL)", "RES 7,A",    // B8-BF
+    "SET 0,B",    "SET 0,C",    "SET 0,D",    "SET 0,E",    "SET 0,H",    "SET 0,L",    "SET 0,(HL)", "SET 0,A",    // C0-C7
+    "SET 1,B",    "SET 1,C",    "SET 1,D",    "SET 1,E",    "SET 1,H",    "SET 1,L",    "SET 1,(HL)", "SET 1,A",    // C8-CF
+    "SET 2,B",    "SET 2,C",    "SET 2,D",    "SET 2,E",    "SET 2,H",    "SET 2,L",    "SET 2,(HL)", "SET 2,A",    // D0-D7
+    "SET 3,B",    "SET 3,C",    "SET 3,D",    "SET 3,E",    "SET 3,H",    "SET 3,L",    "SET 3,(HL)", "SET 3,A",    // D8-DF
+    "SET 4,B",    "SET 4,C",    "SET 4,D",    "SET 4,E",    "SET 4,H",    "SET 4,L",    "SET 4,(HL)", "SET 4,A",    // E0-E7
+    "SET 5,B",    "SET 5,C",    "SET 5,D",    "SET 5,E",    "SET 5,H",    "SET 5,L",    "SET 5,(HL)", "SET 5,A",    // E8-EF
+    "SET 6,B",    "SET 6,C",    "SET 6,D",    "SET 6,E",    "SET 6,H",    "SET 6,L",    "SET 6,(HL)", "SET 6,A",    // F0-F7
+    "SET 7,B",    "SET 7,C",    "SET 7,D",    "SET 7,E",    "SET 7,H",    "SET 7,L",    "SET 7,(HL)", "SET 7,A"     // F8-FF
+    // clang-format on
+};
+
+constexpr uint8_t operand_kind(uint8_t opcode) {
+    switch (opcode) {
+    case (0x10):
+        return OPERAND_NONE; // STOP's second byte is ignored
+    case (0x18):
+    case (0x20):
+    case (0x28):
+    case (0x30):
+    case (0x38):
+        return OPERAND_R8;
+    case (0xCB):
+        return OPERAND_CB;
+    case (0xE0):
+    case (0xF0):
+        return OPERAND_A8;
+    case (0xE8):
+    case (0xF8):
+        return OPERAND_S8;
+    case (0x01):
+    case (0x11):
+    case (0x21):
+    case (0x31):
+        return OPERAND_D16;
+    default:
+        return base_length[opcode] == 2 ? OPERAND_D8 : base_length[opcode] == 3 ? OPERAND_A16 : OPERAND_NONE;
+    }
+}
+
+// CB OP codes take 8 T-cycles, 16 on (HL) for its read and write back,
+// except BIT which only reads it
+constexpr uint8_t cb_cycles(uint8_t cbop) {
+    return (cbop & 0x7) != 0x6 ? 8 : (cbop & 0xC0) == 0x40 ? 12 : 16;
+}
+
+constexpr std::array<opInfo, 0x200> build_op_info() {
+    std::array<opInfo, 0x200> info{};
+
+    for (std::size_t op = 0; op < 0x100; op++) {
+        info[op] = {base_mnemonics[op], base_length[op], base_cycles[op], base_cycles_branch[op], operand_kind((uint8_t)op)};
+        info[0x100 | op] = {cb_mnemonics[op], 2, cb_cycles((uint8_t)op), cb_cycles((uint8_t)op), OPERAND_NONE};
+    }
+    return info;
+}
+
+inline constexpr std::array<opInfo, 0x200> op_info = build_op_info();
+
+static_assert(op_info[0xCB].operand == OPERAND_CB && op_info[0x1CB].cycles == 8, "CB OP codes");
+static_assert(op_info[0x10].length == 2 && op_info[0xE8].operand == OPERAND_S8, "OP code table");
+
+// One instruction as text, e.g. "JR NZ,$0150" or "LDH ($FF44),A". `pc`
+// is the instruction's address (for JR targets); `arg` is its operand,
+// or the second byte for CB.
+std::string disassemble(uint16_t pc, uint8_t opcode, uint16_t arg);
+
+#endif
\ No newline at end of file
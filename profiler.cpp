@@ -0,0 +1,147 @@
+/*
+* Per OP code and per address execution profile
+*/
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+static const char* const table_names[3] = {"op", "cb", "pc"};
+
+// A profile row: which table, where, and what was counted
+struct row {
+    uint8_t table; // Index into table_names
+    int bank;      // -1 outside switchable ROM
+    int pc;        // -1 in the OP code tables
+    const Profiler::entry* e;
+};
+
+// Every non-zero entry, most T-cycles first
+static std::vector<row> rows(const Profiler::entry* ops, const Profiler::entry* cb_ops, const std::vector<Profiler::entry>& addresses) {
+    std::vector<row> out;
+
+    for (std::size_t i = 0; i < 0x100; i++) {
+        if (ops[i].count != 0)
+            out.push_back({0, -1, -1, &ops[i]});
+    }
+    for (std::size_t i = 0; i < 0x100; i++) {
+        if (cb_ops[i].count != 0)
+            out.push_back({1, -1, -1, &cb_ops[i]});
+    }
+    for (std::size_t i = 0; i < addresses.size(); i++) {
+        if (addresses[i].count == 0)
+            continue;
+        if (i < 0x10000)
+            out.push_back({2, -1, (int)i, &addresses[i]});
+        else
+            out.push_back({2, (int)((i - 0x10000) / 0x4000), (int)(0x4000 + (i - 0x10000) % 0x4000), &addresses[i]});
+    }
+
+    std::stable_sort(out.begin(), out.end(), [](const row& a, const row& b) {
+        return a.e->cycles > b.e->cycles;
+    });
+    return out;
+}
+
+Profiler::Profiler() {
+    clear();
+}
+
+// One instruction at pc took `cycles`; bank is the ROM bank mapped at
+// 0x4000 - 0x7FFF at the time
+void Profiler::record(uint16_t bank, uint16_t pc, uint8_t opcode, uint32_t cycles) {
+    std::size_t i = index(bank, pc);
+
+    if (i >= addresses.size())
+        addresses.resize(i + 0x4000 - i % 0x4000);
+
+    ops[opcode].count++;
+    ops[opcode].cycles += cycles;
+    addresses[i].count++;
+    addresses[i].cycles += cycles;
+    addresses[i].opcode = opcode;
+}
+
+// The CB-prefixed part of an instruction already counted by record()
+void Profiler::record_cb(uint8_t cbop, uint32_t cycles) {
+    cb_ops[cbop].count++;
+    cb_ops[cbop].cycles += cycles;
+}
+
+void Profiler::clear() {
+    for (std::size_t i = 0; i < 0x100; i++) {
+        ops[i] = {0, 0, (uint8_t)i};
+        cb_ops[i] = {0, 0, (uint8_t)i};
+    }
+    addresses.assign(0x10000, {0, 0, 0});
+}
+
+// Save the profile as JSON if path ends in .json, CSV otherwise.
+// Returns false if the file can't be written.
+bool Profiler::write(const std::string& path) {
+    std::ofstream out(path);
+
+    if (!out.is_open())
+        return false;
+
+    if (path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0)
+        write_json(out);
+    else
+        write_csv(out);
+    return out.good();
+}
+
+// Private ////////////////////
+
+// Switchable ROM addresses get a slot per bank past the first 64K
+std::size_t Profiler::index(uint16_t bank, uint16_t pc) {
+    if (pc >= 0x4000 && pc < 0x8000)
+        return 0x10000 + (std::size_t)bank * 0x4000 + (pc - 0x4000);
+    return pc;
+}
+
+// table,bank,pc,opcode,count,cycles - bank is only given for switchable
+// ROM, and neither it nor pc for the OP code tables
+void Profiler::write_csv(std::ostream& out) {
+    out << "table,bank,pc,opcode,count,cycles\n" << std::hex << std::setfill('0');
+
+    for (const row& r : rows(ops, cb_ops, addresses)) {
+        out << table_names[r.table] << ",";
+        if (r.bank >= 0)
+            out << std::dec << r.bank << std::hex;
+        out << ",";
+        if (r.pc >= 0)
+            out << "0x" << std::setw(4) << r.pc;
+        out << ",0x" << std::setw(2) << (int)r.e->opcode << std::dec
+            << "," << r.e->count << "," << r.e->cycles << std::hex << "\n";
+    }
+}
+
+// {"op": [...], "cb": [...], "pc": [...]}, entries as in write_csv()
+void Profiler::write_json(std::ostream& out) {
+    std::vector<row> all = rows(ops, cb_ops, addresses);
+
+    out << "{" << std::hex << std::setfill('0');
+    for (std::size_t t = 0; t < 3; t++) {
+        bool first = true;
+
+        out << (t == 0 ? "\n" : ",\n") << "  \"" << table_names[t] << "\": [";
+        for (const row& r : all) {
+            if (r.table != t)
+                continue;
+
+            out << (first ? "\n" : ",\n") << "    {";
+            if (r.bank >= 0)
+                out << "\"bank\": " << std::dec << r.bank << std::hex << ", ";
+            if (r.pc >= 0)
+                out << "\"pc\": \"0x" << std::setw(4) << r.pc << "\", ";
+            out << "\"opcode\": \"0x" << std::setw(2) << (int)r.e->opcode << "\", " << std::dec
+                << "\"count\": " << r.e->count << ", \"cycles\": " << r.e->cycles << std::hex << "}";
+            first = false;
+        }
+        out << (first ? "]" : "\n  ]");
+    }
+    out << "\n}\n";
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// C++ libraries
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Execution counts and T-cycles per OP code, per CB OP code and per
+// instruction address (with ROM bank). Only built into the CPU with
+// GBEMU_PROFILE defined; profiling runs every instruction through the
+// block or step() loops so none are hidden inside native or fused code.
+class Profiler {
+    public:
+    struct entry {
+        uint64_t count;
+        uint64_t cycles;
+        uint8_t opcode; // For addresses: OP code last run there
+    };
+
+    entry ops[0x100];
+    entry cb_ops[0x100];
+
+    Profiler();
+    void record(uint16_t bank, uint16_t pc, uint8_t opcode, uint32_t cycles);
+    void record_cb(uint8_t cbop, uint32_t cycles);
+    void clear();
+    bool write(const std::string& path);
+
+    private:
+    // Indexed by address, then 0x4000 per ROM bank for 0x4000 - 0x7FFF
+    std::vector<entry> addresses;
+
+    static std::size_t index(uint16_t bank, uint16_t pc);
+    void write_csv(std::ostream& out);
+    void write_json(std::ostream& out);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,314 @@
+/*
+* Timer, LCD and serial interrupt sources, computed lazily from the
+* CPU's cycle count
+*/
+
+#include "scheduler.h"
+
+// IO_ports offsets
+static const uint8_t SB = 0x01;
+static const uint8_t SC = 0x02;
+static const uint8_t DIV = 0x04;
+static const uint8_t TIMA = 0x05;
+static const uint8_t TMA = 0x06;
+static const uint8_t TAC = 0x07;
+static const uint8_t IF = 0x0F;
+static const uint8_t LCDC = 0x40;
+static const uint8_t STAT = 0x41;
+static const uint8_t LY = 0x44;
+static const uint8_t LYC = 0x45;
+
+static const uint32_t NO_EVENT = UINT32_MAX;
+
+Scheduler::Scheduler() {
+    div_offset = 0xABCC; // DIV reads 0xAB after the boot ROM
+    timer_synced = 0;
+    lcd_origin = 0;
+    lcd_synced = 0;
+    serial_end = NEVER;
+}
+
+// SOURCE_* bit for a timed register, see Memory::io_registers. The
+// rest only change when written, so they have none.
+uint8_t Scheduler::source(uint16_t addr) {
+    switch (addr) {
+    case (0xFF02):
+        return SOURCE_SERIAL;
+    case (0xFF04):
+        return SOURCE_DIV;
+    case (0xFF05):
+        return SOURCE_TIMER;
+    case (0xFF0F):
+        return SOURCE_IRQ;
+    case (0xFF41):
+    case (0xFF44):
+        return SOURCE_LCD;
+    default:
+        return 0x00;
+    }
+}
+
+// Bring DIV, TIMA, LY, STAT, SB/SC and IF up to cycle `now`
+void Scheduler::sync(uint64_t now, uint8_t* io) {
+    sync_timer(now, io);
+    sync_lcd(now, io);
+
+    if (now >= serial_end) {
+        io[SB] = 0xFF; // Nothing on the other end
+        io[SC] &= 0x7F;
+        io[IF] |= IRQ_SERIAL;
+        serial_end = NEVER;
+    }
+}
+
+// First cycle after `now` at which an IF bit gets set, or NEVER
+uint64_t Scheduler::next_event(uint64_t now, uint8_t* io) {
+    sync(now, io);
+
+    uint64_t next = serial_end;
+    uint64_t timer = next_timer(now, io);
+    uint64_t lcd = next_lcd(now, io);
+
+    if (timer < next)
+        next = timer;
+    if (lcd < next)
+        next = lcd;
+    return next;
+}
+
+// First cycle after `now` at which a register following any of
+// `sources` can read differently without being written, or NEVER
+uint64_t Scheduler::next_change(uint8_t sources, uint64_t now, uint8_t* io) {
+    // Also brings everything up to `now`
+    uint64_t next = next_event(now, io);
+
+    if (!(sources & SOURCE_IRQ))
+        next = NEVER;
+
+    if (sources & SOURCE_DIV) {
+        uint64_t tick = ((((now + div_offset) >> 8) + 1) << 8) - div_offset;
+
+        if (tick < next)
+            next = tick;
+    }
+
+    if ((sources & SOURCE_TIMER) && (io[TAC] & 0x04)) {
+        uint8_t shift = timer_shift(io[TAC]);
+        uint64_t tick = ((((now + div_offset) >> shift) + 1) << shift) - div_offset;
+
+        if (tick < next)
+            next = tick;
+    }
+
+    // LY moves on at the end of each line, STAT's mode at 80 and
+    // HBLANK_START dots into the visible ones
+    if ((sources & SOURCE_LCD) && (io[LCDC] & 0x80)) {
+        uint32_t pos = (now - lcd_origin) % FRAME_CYCLES;
+        uint32_t dot = pos % LINE_CYCLES;
+        uint32_t until = pos >= VBLANK_START || dot >= HBLANK_START ? LINE_CYCLES : dot < 80 ? 80 : HBLANK_START;
+
+        if (now - dot + until < next)
+            next = now - dot + until;
+    }
+
+    if ((sources & SOURCE_SERIAL) && serial_end < next)
+        next = serial_end;
+    return next;
+}
+
+// Write to one of the timed registers: SC, DIV, TIMA, TMA, TAC, IF,
+// LCDC, STAT, LY or LYC
+void Scheduler::write(uint16_t addr, uint8_t val, uint64_t now, uint8_t* io) {
+    sync(now, io);
+
+    switch (addr) {
+    case (0xFF02):
+        io[SC] = val;
+        // Only an internal clock transfer ever finishes on its own
+        if ((val & 0x81) == 0x81)
+            serial_end = now + SERIAL_CYCLES;
+        break;
+    case (0xFF04):
+        // Resetting the divider can drop the bit TIMA counts on
+        if ((io[TAC] & 0x04) && (((now + div_offset) >> (timer_shift(io[TAC]) - 1)) & 0x1)) {
+            if (++io[TIMA] == 0x00) {
+                io[TIMA] = io[TMA];
+                io[IF] |= IRQ_TIMER;
+            }
+        }
+        div_offset = 0 - now;
+        io[DIV] = 0x00;
+        break;
+    case (0xFF05):
+        io[TIMA] = val;
+        break;
+    case (0xFF06):
+        io[TMA] = val;
+        break;
+    case (0xFF07):
+        io[TAC] = val | 0xF8;
+        break;
+    case (0xFF0F):
+        io[IF] = val | 0xE0;
+        break;
+    case (0xFF40):
+        if ((val & 0x80) && !(io[LCDC] & 0x80)) {
+            lcd_origin = now;
+            lcd_synced = now;
+        }
+        else if (!(val & 0x80)) {
+            io[LY] = 0x00;
+            io[STAT] &= 0xFC;
+        }
+        io[LCDC] = val;
+        sync_lcd(now, io);
+        break;
+    case (0xFF41):
+        io[STAT] = (io[STAT] & 0x07) | (val & 0x78);
+        break;
+    case (0xFF45):
+        io[LYC] = val;
+        sync_lcd(now, io);
+        break;
+    default:
+        // LY is read-only
+        break;
+    }
+}
+
+// Private ////////////////////
+
+// TIMA counts falling edges of divider bit 9, 3, 5 or 7,
+// i.e. every 2^shift cycles
+uint8_t Scheduler::timer_shift(uint8_t tac) {
+    static const uint8_t shift[4] = {10, 4, 6, 8};
+
+    return shift[tac & 0x3];
+}
+
+void Scheduler::sync_timer(uint64_t now, uint8_t* io) {
+    if ((io[TAC] & 0x04) && now > timer_synced) {
+        uint8_t shift = timer_shift(io[TAC]);
+        uint64_t ticks = ((now + div_offset) >> shift) - ((timer_synced + div_offset) >> shift);
+        uint32_t left = 0x100 - io[TIMA];
+
+        if (ticks >= left) {
+            io[TIMA] = io[TMA] + (ticks - left) % (0x100 - io[TMA]);
+            io[IF] |= IRQ_TIMER;
+        }
+        else {
+            io[TIMA] += ticks;
+        }
+    }
+
+    timer_synced = now;
+    io[DIV] = (uint8_t)((now + div_offset) >> 8);
+}
+
+void Scheduler::sync_lcd(uint64_t now, uint8_t* io) {
+    if (!(io[LCDC] & 0x80)) {
+        lcd_synced = now;
+        return;
+    }
+
+    // A frame or more behind: every enabled source has fired at least once
+    if (now - lcd_synced > FRAME_CYCLES) {
+        io[IF] |= IRQ_VBLANK;
+        if ((io[STAT] & 0x38) || ((io[STAT] & 0x40) && io[LYC] < 154))
+            io[IF] |= IRQ_STAT;
+        lcd_synced = now - FRAME_CYCLES;
+    }
+
+    for (uint64_t t = next_lcd(lcd_synced, io); t <= now; t = next_lcd(t, io)) {
+        io[IF] |= lcd_irqs((t - lcd_origin) % FRAME_CYCLES, io);
+    }
+    lcd_synced = now;
+
+    uint32_t pos = (now - lcd_origin) % FRAME_CYCLES;
+    uint8_t line = pos / LINE_CYCLES;
+    uint32_t dot = pos % LINE_CYCLES;
+    uint8_t mode = line >= 144 ? 1 : dot < 80 ? 2 : dot < HBLANK_START ? 3 : 0;
+
+    io[LY] = line;
+    io[STAT] = (io[STAT] & 0x78) | (line == io[LYC] ? 0x04 : 0x00) | mode;
+}
+
+// Cycle TIMA next overflows at, with the timer synced to `now`
+uint64_t Scheduler::next_timer(uint64_t now, uint8_t* io) {
+    if (!(io[TAC] & 0x04))
+        return NEVER;
+
+    uint8_t shift = timer_shift(io[TAC]);
+    uint64_t edge = ((now + div_offset) >> shift) + (0x100 - io[TIMA]);
+
+    return (edge << shift) - div_offset;
+}
+
+// First cycle after `after` that raises an LCD interrupt
+uint64_t Scheduler::next_lcd(uint64_t after, uint8_t* io) {
+    if (!(io[LCDC] & 0x80))
+        return NEVER;
+
+    uint64_t frame = (after - lcd_origin) / FRAME_CYCLES;
+    uint32_t pos = (after - lcd_origin) % FRAME_CYCLES;
+    uint32_t event = first_lcd_event(pos + 1, io);
+
+    // VBlank always fires, so the next frame has one if this one didn't
+    if (event == NO_EVENT)
+        event = FRAME_CYCLES + first_lcd_event(0, io);
+    return lcd_origin + frame * FRAME_CYCLES + event;
+}
+
+// First position in the frame at or after `from` with an interrupt
+uint32_t Scheduler::first_lcd_event(uint32_t from, uint8_t* io) {
+    uint8_t stat = io[STAT];
+    uint32_t best = from <= VBLANK_START ? VBLANK_START : NO_EVENT;
+
+    // Mode 2 at the start of each visible line
+    if (stat & 0x20) {
+        uint32_t line = (from + LINE_CYCLES - 1) / LINE_CYCLES;
+
+        if (line < 144 && line * LINE_CYCLES < best)
+            best = line * LINE_CYCLES;
+    }
+
+    // Mode 0 part way through each visible line
+    if (stat & 0x08) {
+        uint32_t line = from / LINE_CYCLES;
+
+        if (line * LINE_CYCLES + HBLANK_START < from)
+            line++;
+        if (line < 144 && line * LINE_CYCLES + HBLANK_START < best)
+            best = line * LINE_CYCLES + HBLANK_START;
+    }
+
+    // LY = LYC at the start of that line
+    if ((stat & 0x40) && io[LYC] < 154) {
+        uint32_t at = io[LYC] * LINE_CYCLES;
+
+        if (at >= from && at < best)
+            best = at;
+    }
+    return best;
+}
+
+// IF bits raised at position `pos` in the frame
+uint8_t Scheduler::lcd_irqs(uint32_t pos, uint8_t* io) {
+    uint8_t stat = io[STAT];
+    uint32_t line = pos / LINE_CYCLES;
+    uint32_t dot = pos % LINE_CYCLES;
+    uint8_t irqs = 0x00;
+
+    if (pos == VBLANK_START) {
+        irqs |= IRQ_VBLANK;
+        if (stat & 0x10)
+            irqs |= IRQ_STAT;
+    }
+    if (line < 144 && dot == 0 && (stat & 0x20))
+        irqs |= IRQ_STAT;
+    if (line < 144 && dot == HBLANK_START && (stat & 0x08))
+        irqs |= IRQ_STAT;
+    if (dot == 0 && line == io[LYC] && (stat & 0x40))
+        irqs |= IRQ_STAT;
+    return irqs;
+}
\ No newline at end of file
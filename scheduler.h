@@ -0,0 +1,60 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+// C++ libraries
+#include <cstddef>
+#include <cstdint>
+
+// Timer, LCD line timing and serial port, worked out from the CPU's
+// T-cycle count when they are looked at rather than ticked along with
+// it. Their registers live in Memory's IO_ports; sync() brings those
+// (and IF) up to a given cycle, and next_event() says when the next
+// interrupt request will be raised, so a halted CPU can skip there.
+class Scheduler {
+    public:
+    static const uint64_t NEVER = UINT64_MAX;
+
+    static const uint32_t LINE_CYCLES = 456;
+    static const uint32_t FRAME_CYCLES = 154 * LINE_CYCLES;
+    static const uint32_t VBLANK_START = 144 * LINE_CYCLES;
+    static const uint32_t HBLANK_START = 80 + 172; // Mode 2, then mode 3
+    static const uint32_t SERIAL_CYCLES = 8 * 512; // 8 bits at 8192 Hz
+
+    // IF bits
+    static const uint8_t IRQ_VBLANK = 0x01;
+    static const uint8_t IRQ_STAT = 0x02;
+    static const uint8_t IRQ_TIMER = 0x04;
+    static const uint8_t IRQ_SERIAL = 0x08;
+    static const uint8_t IRQ_JOYPAD = 0x10;
+
+    // What a timed register's value follows, for next_change()
+    static const uint8_t SOURCE_DIV = 0x01;
+    static const uint8_t SOURCE_TIMER = 0x02;
+    static const uint8_t SOURCE_LCD = 0x04;
+    static const uint8_t SOURCE_SERIAL = 0x08;
+    static const uint8_t SOURCE_IRQ = 0x10;
+
+    Scheduler();
+    static uint8_t source(uint16_t addr);
+    void sync(uint64_t now, uint8_t* io);
+    uint64_t next_event(uint64_t now, uint8_t* io);
+    uint64_t next_change(uint8_t sources, uint64_t now, uint8_t* io);
+    void write(uint16_t addr, uint8_t val, uint64_t now, uint8_t* io);
+
+    private:
+    uint64_t div_offset;   // Internal 16-bit divider is (now + div_offset)
+    uint64_t timer_synced; // Cycle TIMA was last brought up to date
+    uint64_t lcd_origin;   // Cycle the LCD was switched on (line 0, dot 0)
+    uint64_t lcd_synced;   // Cycle LCD interrupts were last raised up to
+    uint64_t serial_end;   // Cycle the current transfer finishes, or NEVER
+
+    static uint8_t timer_shift(uint8_t tac);
+    void sync_timer(uint64_t now, uint8_t* io);
+    void sync_lcd(uint64_t now, uint8_t* io);
+    uint64_t next_timer(uint64_t now, uint8_t* io);
+    uint64_t next_lcd(uint64_t after, uint8_t* io);
+    static uint32_t first_lcd_event(uint32_t from, uint8_t* io);
+    static uint8_t lcd_irqs(uint32_t pos, uint8_t* io);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+/*
+* testrunner - run CPU test ROMs headless and report pass/fail, wall
+* time and emulated speed for each
+*
+* Usage: testrunner <ROM file or directory> [options]
+*   -c <seconds>  Emulated seconds a ROM gets before it times out (default: 60)
+*   -k <core>     interpreter, blocks, jit or mcycle (default: jit)
+*
+* A directory runs every .gb file in it, in name order. Results:
+*   Blargg-style ROMs print to the serial port and pass once "Passed"
+*   comes out, fail on "Failed".
+*   Mooneye-style ROMs finish with LD B,B and B/C/D/E/H/L holding
+*   3/5/8/13/21/34 on a pass, 0x42 in all six on a failure. The
+*   registers are only looked at once an LD B,B has run.
+* The exit status is 0 only if every ROM passed, so it can gate a build.
+*
+* Speed is in emulated MIPS (Game Boy instructions retired a second,
+* including ones in skipped idle loop passes) and as a multiple of the
+* real 4.19 MHz clock.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+
+static const double CLOCK_HZ = 4194304.0;
+
+enum testResult : uint8_t {
+    RESULT_PASSED,
+    RESULT_FAILED,
+    RESULT_TIMEOUT,
+    RESULT_NO_ROM
+};
+
+static const char* const result_names[] = {"passed", "FAILED", "TIMEOUT", "NO ROM"};
+
+struct testRun {
+    uint8_t result; // testResult
+    uint64_t cycles;
+    uint64_t instructions;
+    double seconds; // Wall time
+};
+
+static uint8_t result_of(CPU& cpu, const std::string& serial) {
+    if (serial.find("Passed") != std::string::npos)
+        return RESULT_PASSED;
+    if (serial.find("Failed") != std::string::npos)
+        return RESULT_FAILED;
+
+    // Mooneye: a register signature, left behind by its LD B,B breakpoint
+    if (!cpu.breakpoint)
+        return RESULT_TIMEOUT;
+    cpu.breakpoint = false;
+
+    CPU::registerMap& r = cpu.registers;
+
+    if (r.B == 3 && r.C == 5 && r.D == 8 && r.E == 13 && r.H == 21 && r.L == 34)
+        return RESULT_PASSED;
+    if (r.B == 0x42 && r.C == 0x42 && r.D == 0x42 && r.E == 0x42 && r.H == 0x42 && r.L == 0x42)
+        return RESULT_FAILED;
+    return RESULT_TIMEOUT;
+}
+
+static testRun run_rom(const std::string& path, uint8_t core, uint64_t limit) {
+    std::unique_ptr<CPU> cpu(new CPU());
+    std::string serial;
+
+    if (!cpu->gbmemory.load_rom(path))
+        return {RESULT_NO_ROM, 0, 0, 0.0};
+    cpu->core = core;
+    cpu->gbmemory.serial_out = &serial;
+
+    // A frame at a time, looking for a result in between
+    uint8_t result = RESULT_TIMEOUT;
+    auto start = std::chrono::steady_clock::now();
+
+    while (cpu->cycles < limit && result == RESULT_TIMEOUT) {
+        cpu->run_for(Scheduler::FRAME_CYCLES);
+        result = result_of(*cpu, serial);
+    }
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+    return {result, cpu->cycles, cpu->instructions, wall.count()};
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <ROM file or directory> [-c seconds] [-k interpreter|blocks|jit|mcycle]" << std::endl;
+        return 1;
+    }
+
+    uint64_t limit = 60 * (uint64_t)CLOCK_HZ;
+    uint8_t core = CPU::CORE_JIT;
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        std::string val = argv[i + 1];
+
+        if (opt == "-c") {
+            limit = (uint64_t)(std::strtod(val.c_str(), nullptr) * CLOCK_HZ);
+        }
+        else if (opt == "-k") {
+            core = 0;
+            while (core < CPU::CORE_COUNT && val != CPU::core_names[core])
+                core++;
+            if (core == CPU::CORE_COUNT) {
+                std::cout << "Unknown core \'" << val << "\'" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    std::vector<std::string> roms;
+    std::error_code error;
+
+    if (std::filesystem::is_directory(argv[1], error)) {
+        for (const auto& entry : std::filesystem::directory_iterator(argv[1], error)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".gb")
+                roms.push_back(entry.path().string());
+        }
+        std::sort(roms.begin(), roms.end());
+    }
+    else {
+        roms.push_back(argv[1]);
+    }
+    if (roms.empty()) {
+        std::cout << "No .gb files in \'" << argv[1] << "\'" << std::endl;
+        return 1;
+    }
+
+    unsigned passed = 0;
+    uint64_t total_instructions = 0;
+    double total_seconds = 0.0;
+
+    std::printf("%-40s %-7s %12s %9s %9s %7s\n", "ROM", "result", "instructions", "wall ms", "MIPS", "speed");
+    for (const std::string& path : roms) {
+        testRun run = run_rom(path, core, limit);
+        double mips = run.seconds > 0.0 ? run.instructions / run.seconds / 1e6 : 0.0;
+        double speed = run.seconds > 0.0 ? run.cycles / run.seconds / CLOCK_HZ : 0.0;
+        std::string name = std::filesystem::path(path).filename().string();
+
+        std::printf("%-40s %-7s %12llu %9.1f %9.1f %6.0fx\n", name.c_str(), result_names[run.result],
+                    (unsigned long long)run.instructions, run.seconds * 1000.0, mips, speed);
+        if (run.result == RESULT_PASSED)
+            passed++;
+        total_instructions += run.instructions;
+        total_seconds += run.seconds;
+    }
+
+    double mips = total_seconds > 0.0 ? total_instructions / total_seconds / 1e6 : 0.0;
+
+    std::printf("%u/%zu passed, %.1f ms, %.1f MIPS\n", passed, roms.size(), total_seconds * 1000.0, mips);
+    return passed == roms.size() ? 0 : 1;
+}
\ No newline at end of file
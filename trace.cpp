@@ -0,0 +1,73 @@
+/*
+* Instruction trace ring buffer and its file format
+*/
+
+#include "trace.h"
+
+#include <cstring>
+#include <fstream>
+
+static const char MAGIC[8] = {'G', 'B', 'T', 'R', 'A', 'C', 'E', '\0'};
+
+// Room for at least `records`, rounded up to a power of two
+Trace::Trace(std::size_t records) {
+    std::size_t n = 1;
+
+    while (n < records) {
+        n <<= 1;
+    }
+    ring.resize(n);
+    mask = n - 1;
+    next = 0;
+}
+
+// Records held, at most the buffer's length
+std::size_t Trace::size() const {
+    return next < ring.size() ? (std::size_t)next : ring.size();
+}
+
+void Trace::clear() {
+    next = 0;
+}
+
+// Write the held records, oldest first. Returns false if the file
+// can't be written.
+bool Trace::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    header h;
+
+    if (!out.is_open())
+        return false;
+
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.record_size = sizeof(record);
+    h.reserved = 0;
+    h.count = size();
+    out.write((const char*)&h, sizeof(h));
+
+    if (next <= ring.size()) {
+        out.write((const char*)ring.data(), next * sizeof(record));
+    }
+    else {
+        // Wrapped: the oldest record is the next one to be overwritten
+        std::size_t first = next & mask;
+
+        out.write((const char*)&ring[first], (ring.size() - first) * sizeof(record));
+        out.write((const char*)ring.data(), first * sizeof(record));
+    }
+    return out.good();
+}
+
+// Read a file written by save(). Returns false if it isn't one.
+bool Trace::load(const std::string& path, std::vector<record>& out) {
+    std::ifstream in(path, std::ios::binary);
+    header h;
+
+    if (!in.read((char*)&h, sizeof(h)))
+        return false;
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.record_size != sizeof(record))
+        return false;
+
+    out.resize(h.count);
+    return (bool)in.read((char*)out.data(), h.count * sizeof(record));
+}
@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// C++ libraries
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The last N instructions run, kept in a ring buffer of fixed-size
+// binary records: one store per instruction, nothing formatted until
+// the buffer is saved. Only built into the CPU with GBEMU_TRACE
+// defined. Saved files start with a `header` and hold the records
+// oldest first, in host byte order; tracedump turns them into text.
+class Trace {
+    public:
+    static const std::size_t DEFAULT_RECORDS = 1 << 22; // 96 MiB
+
+    // CPU state just before the instruction ran
+    struct record {
+        uint64_t cycles;
+        uint16_t pc, sp, af, bc, de, hl;
+        uint16_t arg;   // Immediate operand, or the CB OP code
+        uint8_t opcode;
+        uint8_t bank;   // ROM bank mapped at 0x4000 - 0x7FFF, low 8 bits
+    };
+
+    struct header {
+        char magic[8];        // "GBTRACE\0"
+        uint32_t record_size; // sizeof(record)
+        uint32_t reserved;
+        uint64_t count;       // Records that follow
+    };
+
+    Trace(std::size_t records = DEFAULT_RECORDS);
+    void add(const record& r) {
+        ring[next++ & mask] = r;
+    }
+    std::size_t size() const;
+    void clear();
+    bool save(const std::string& path) const;
+    static bool load(const std::string& path, std::vector<record>& out);
+
+    private:
+    std::vector<record> ring; // Power of two long
+    std::size_t mask;
+    uint64_t next; // Records ever added
+};
+
+static_assert(sizeof(Trace::record) == 24, "Trace records are meant to pack into 24 bytes");
+
+#endif
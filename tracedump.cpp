@@ -0,0 +1,48 @@
+/*
+* tracedump - print a GBEMU_TRACE file as text, one instruction a line
+*
+* Usage: tracedump <trace file> [last N records]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "opinfo.h"
+#include "trace.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <trace file> [last N records]" << std::endl;
+        return 1;
+    }
+
+    std::vector<Trace::record> records;
+
+    if (!Trace::load(argv[1], records)) {
+        std::cout << "Error reading trace \'" << argv[1] << "\'" << std::endl;
+        return 1;
+    }
+
+    std::size_t first = 0;
+
+    if (argc > 2) {
+        std::size_t last = std::strtoull(argv[2], nullptr, 10);
+
+        if (last < records.size())
+            first = records.size() - last;
+    }
+
+    std::printf("%-12s %-7s %-2s %-4s  %-18s %-4s %-4s %-4s %-4s %-4s\n", "cycles", "bank:pc", "op", "arg", "instruction", "AF", "BC", "DE", "HL", "SP");
+    for (std::size_t i = first; i < records.size(); i++) {
+        const Trace::record& r = records[i];
+
+        std::string text = disassemble(r.pc, r.opcode, r.arg);
+
+        std::printf("%-12llu %02X:%04X %02X %04X  %-18s %04X %04X %04X %04X %04X\n",
+                    (unsigned long long)r.cycles, r.bank, r.pc, r.opcode, r.arg, text.c_str(), r.af, r.bc, r.de, r.hl, r.sp);
+    }
+    return 0;
+}